@@ -0,0 +1,284 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef SK_ATOMIC_VALUE_HXX_INCLUDED
+#define SK_ATOMIC_VALUE_HXX_INCLUDED
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "sk/value.hxx"
+
+/*
+ * atomic_value - a value which can be read and replaced from several threads
+ * at once.
+ *
+ * The current value is held in an immutable heap node.  Writers publish a
+ * new node with a single atomic pointer swap and hand the old one to an
+ * epoch-based reclaimer, which destroys it once every reader which might
+ * still see it has finished.  Readers only announce the current epoch in a
+ * per-thread slot and load the pointer: they never wait for writers or for
+ * each other, and they do not write to any memory shared with other readers.
+ *
+ * read() returns a guard through which the current value can be used
+ * without copying it; the value stays alive until the guard is destroyed.
+ * Guards should be short-lived, since an open guard delays the reclamation
+ * of every value replaced in the meantime.
+ *
+ * Writers are not lock-free: the pointer swap itself never blocks, but each
+ * replaced value is queued for reclamation under a mutex shared by all
+ * writers.  Readers never take it.
+ */
+
+namespace sk {
+
+    namespace detail {
+
+        // The reader state of one thread.  Records are reused when their
+        // thread exits, and are never freed.
+        struct alignas(64) value_epoch_record {
+            // The epoch the thread is reading in, or 0 if it is not reading.
+            std::atomic<std::uint64_t> epoch{0};
+            std::atomic<bool> in_use{true};
+            unsigned depth = 0;
+            value_epoch_record *next = nullptr;
+        };
+
+        class value_epoch_domain {
+        public:
+            static auto global() -> value_epoch_domain & {
+                static value_epoch_domain domain;
+                return domain;
+            }
+
+            value_epoch_domain() = default;
+            value_epoch_domain(value_epoch_domain const &) = delete;
+            auto operator=(value_epoch_domain const &)
+                -> value_epoch_domain & = delete;
+
+            ~value_epoch_domain() {
+                for (auto &r : retired)
+                    delete r.object;
+            }
+
+            // Start a read-side critical section.  Nests.
+            auto enter() -> value_epoch_record & {
+                auto &r = local();
+                if (r.depth++ == 0)
+                    r.epoch.store(epoch.load());
+                return r;
+            }
+
+            void leave(value_epoch_record &r) {
+                if (--r.depth == 0)
+                    r.epoch.store(0, std::memory_order_release);
+            }
+
+            // Destroy v once no reader can still be using it.
+            void retire(value const *v) {
+                std::vector<value const *> done;
+                {
+                    std::lock_guard lock(mutex);
+                    retired.push_back({v, epoch.load()});
+                    if (retired.size() < reclaim_threshold)
+                        return;
+
+                    try_advance();
+                    auto now = epoch.load();
+                    std::erase_if(retired, [&](auto const &r) {
+                        if (r.epoch + 2 > now)
+                            return false;
+                        done.push_back(r.object);
+                        return true;
+                    });
+                }
+
+                for (auto const *p : done)
+                    delete p;
+            }
+
+        private:
+            static constexpr std::size_t reclaim_threshold = 64;
+
+            struct retired_object {
+                value const *object;
+                std::uint64_t epoch;
+            };
+
+            std::atomic<std::uint64_t> epoch{1};
+            std::atomic<value_epoch_record *> records{nullptr};
+            std::mutex mutex;
+            std::vector<retired_object> retired;
+
+            auto local() -> value_epoch_record & {
+                struct owner {
+                    value_epoch_record *record = nullptr;
+                    ~owner() {
+                        if (record)
+                            record->in_use.store(false,
+                                                 std::memory_order_release);
+                    }
+                };
+
+                thread_local owner self;
+                if (!self.record)
+                    self.record = acquire();
+                return *self.record;
+            }
+
+            auto acquire() -> value_epoch_record * {
+                for (auto *r = records.load(); r; r = r->next) {
+                    bool expected = false;
+                    if (!r->in_use.load(std::memory_order_relaxed) &&
+                        r->in_use.compare_exchange_strong(expected, true))
+                        return r;
+                }
+
+                auto *r = new value_epoch_record;
+                r->next = records.load();
+                while (!records.compare_exchange_weak(r->next, r))
+                    ;
+                return r;
+            }
+
+            // Move to the next epoch if every active reader has seen the
+            // current one.
+            void try_advance() {
+                auto now = epoch.load();
+                for (auto *r = records.load(); r; r = r->next) {
+                    auto e = r->epoch.load();
+                    if (e != 0 && e != now)
+                        return;
+                }
+                epoch.compare_exchange_strong(now, now + 1);
+            }
+        };
+
+    } // namespace detail
+
+    class atomic_value {
+    public:
+        // Read access to the value held when the guard was created.
+        class reader {
+        public:
+            explicit reader(atomic_value const &v)
+                : record(detail::value_epoch_domain::global().enter()),
+                  object(v.current.load()) {}
+
+            reader(reader const &) = delete;
+            auto operator=(reader const &) -> reader & = delete;
+
+            ~reader() {
+                detail::value_epoch_domain::global().leave(record);
+            }
+
+            auto operator*() const -> value const & {
+                return *object;
+            }
+
+            auto operator->() const -> value const * {
+                return object;
+            }
+
+        private:
+            detail::value_epoch_record &record;
+            value const *object;
+        };
+
+        atomic_value() : current(new value) {}
+
+        explicit atomic_value(value v) : current(new value(std::move(v))) {}
+
+        atomic_value(atomic_value const &) = delete;
+        auto operator=(atomic_value const &) -> atomic_value & = delete;
+
+        // Must not be destroyed while other threads are using it.
+        ~atomic_value() {
+            delete current.load();
+        }
+
+        // Borrow the current value without copying it.
+        auto read() const -> reader {
+            return reader(*this);
+        }
+
+        // Return a copy of the current value.
+        auto load() const -> value {
+            return *read();
+        }
+
+        void store(value v) {
+            retire(current.exchange(new value(std::move(v))));
+        }
+
+        // Replace the value, returning the previous one.
+        auto exchange(value v) -> value {
+            auto guard = read();
+            auto const *old = current.exchange(new value(std::move(v)));
+            value previous(*old);
+            retire(old);
+            return previous;
+        }
+
+        // If the current value equals expected, replace it with desired and
+        // return true.  Otherwise, set expected to the current value and
+        // return false.
+        auto compare_exchange(value &expected, value desired) -> bool {
+            auto guard = read();
+            auto const *node = new value(std::move(desired));
+            auto const *old = current.load();
+
+            for (;;) {
+                if (!(*old == expected)) {
+                    expected = *old;
+                    delete node;
+                    return false;
+                }
+
+                if (current.compare_exchange_weak(old, node)) {
+                    retire(old);
+                    return true;
+                }
+            }
+        }
+
+    private:
+        std::atomic<value const *> current;
+
+        static void retire(value const *v) {
+            detail::value_epoch_domain::global().retire(v);
+        }
+    };
+
+} // namespace sk
+
+#endif // SK_ATOMIC_VALUE_HXX_INCLUDED
@@ -0,0 +1,346 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef SK_BASIC_VALUE_HXX_INCLUDED
+#define SK_BASIC_VALUE_HXX_INCLUDED
+
+#include <concepts>
+#include <cstddef>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include <variant>
+
+#include "sk/value.hxx"
+
+/*
+ * basic_value - a value which stores a closed set of types inline.
+ *
+ * basic_value<Ts...> behaves like sk::value, but objects of the listed types
+ * are stored in a tagged union inside the basic_value rather than in a heap
+ * allocated value_instance, and comparison, hashing, printing and casting
+ * dispatch on the union's index instead of through virtual calls.  Objects
+ * of any other value_containable type are stored in a boxed sk::value, so
+ * nothing is lost by choosing a small set of types:
+ *
+ *   using fast_value = sk::basic_value<std::int64_t, double, bool,
+ *                                      std::string>;
+ *
+ * A basic_value compares, orders and hashes exactly like an sk::value
+ * holding the same object, and the two can be compared with each other and
+ * converted in both directions.
+ */
+
+namespace sk {
+
+    namespace detail {
+
+        template <typename T, typename... Ts>
+        inline constexpr bool value_one_of = (std::same_as<T, Ts> || ...);
+
+        template <typename... Ts> struct value_distinct : std::true_type {};
+
+        template <typename T, typename... Ts>
+        struct value_distinct<T, Ts...>
+            : std::bool_constant<!value_one_of<T, Ts...> &&
+                                 value_distinct<Ts...>::value> {};
+
+    } // namespace detail
+
+    template <value_containable... Ts>
+        requires(detail::value_distinct<Ts...>::value &&
+                 !detail::value_one_of<nullptr_t, Ts...>)
+    class basic_value {
+    public:
+        // Create an empty value.
+        basic_value() = default;
+
+        // Create a value from a value_containable; listed types are stored
+        // inline and anything else is boxed.
+        template <typename T>
+            requires(value_containable<std::remove_cvref_t<T>> &&
+                     !std::same_as<std::remove_cvref_t<T>, basic_value>)
+        explicit basic_value(T &&v) {
+            using type = std::remove_cvref_t<T>;
+            if constexpr (std::same_as<type, nullptr_t>)
+                ;
+            else if constexpr (detail::value_one_of<type, Ts...>)
+                storage.template emplace<type>(std::forward<T>(v));
+            else
+                storage.template emplace<value>(std::forward<T>(v));
+        }
+
+        // As for sk::value, C strings are stored as std::string.
+        explicit basic_value(char const *s)
+            : basic_value(std::string(s)) {}
+
+        // Convert from an sk::value, unboxing listed types.
+        explicit basic_value(value const &v) {
+            assign(v);
+        }
+
+        explicit basic_value(value &&v) {
+            assign(std::move(v));
+        }
+
+        auto operator=(value const &v) -> basic_value & {
+            storage.template emplace<0>();
+            assign(v);
+            return *this;
+        }
+
+        // Convert to an sk::value.  (sk::value{b} would store the
+        // basic_value itself as the object.)
+        auto to_value() const -> value {
+            return std::visit(
+                [](auto const &o) -> value {
+                    using type = std::remove_cvref_t<decltype(o)>;
+                    if constexpr (std::same_as<type, std::monostate>)
+                        return value();
+                    else
+                        return value(o);
+                },
+                storage);
+        }
+
+        auto empty() const -> bool {
+            return storage.index() == 0;
+        }
+
+        // Whether the object is stored inline.
+        auto is_inline() const -> bool {
+            return storage.index() != std::variant_size_v<storage_type> - 1;
+        }
+
+        auto str() const -> std::string {
+            return std::visit(
+                [](auto const &o) -> std::string {
+                    using type = std::remove_cvref_t<decltype(o)>;
+                    if constexpr (std::same_as<type, std::monostate>)
+                        return value_containable_to_string(nullptr);
+                    else if constexpr (std::same_as<type, value>)
+                        return o.str();
+                    else
+                        return value_containable_to_string(o);
+                },
+                storage);
+        }
+
+        auto hash() const -> std::size_t {
+            return std::visit(
+                [](auto const &o) -> std::size_t {
+                    using type = std::remove_cvref_t<decltype(o)>;
+                    if constexpr (std::same_as<type, std::monostate>)
+                        return std::hash<nullptr_t>{}(nullptr);
+                    else
+                        return std::hash<type>{}(o);
+                },
+                storage);
+        }
+
+        // The instance type this value behaves as; see value_base::type().
+        auto type() const -> std::type_info const & {
+            return std::visit(
+                [](auto const &o) -> std::type_info const & {
+                    using type = std::remove_cvref_t<decltype(o)>;
+                    if constexpr (std::same_as<type, std::monostate>)
+                        return typeid(value_instance<nullptr_t>);
+                    else if constexpr (std::same_as<type, value>)
+                        return o.object->type();
+                    else
+                        return typeid(value_instance<type>);
+                },
+                storage);
+        }
+
+        // A pointer to the object if it has type To, or nullptr.
+        template <value_containable To> auto get_if() const -> To const * {
+            if constexpr (detail::value_one_of<To, Ts...>)
+                return std::get_if<To>(&storage);
+            else if constexpr (std::same_as<To, nullptr_t>)
+                return nullptr;
+            else if (auto const *boxed = std::get_if<value>(&storage))
+                return value_cast<To>(boxed);
+            else
+                return nullptr;
+        }
+
+        friend auto operator==(basic_value const &a, basic_value const &b)
+            -> bool {
+            return a.storage == b.storage;
+        }
+
+        friend auto operator==(basic_value const &a, value const &b) -> bool {
+            return std::visit(
+                [&](auto const &o) -> bool {
+                    using type = std::remove_cvref_t<decltype(o)>;
+                    if constexpr (std::same_as<type, std::monostate>)
+                        return b.empty();
+                    else if constexpr (std::same_as<type, value>)
+                        return o == b;
+                    else if constexpr (std::same_as<type, std::string>) {
+                        auto s = value_string_view(b);
+                        return s && *s == o;
+                    } else {
+                        auto const *p = detail::value_probe<type>(&b);
+                        return p && *p == o;
+                    }
+                },
+                a.storage);
+        }
+
+        template <value_containable T>
+        friend auto operator==(basic_value const &a, T const &b) -> bool {
+            auto const *p = a.get_if<T>();
+            return p && *p == b;
+        }
+
+        friend auto operator==(basic_value const &a, char const *b) -> bool {
+            auto const *p = a.get_if<std::string>();
+            return p && *p == b;
+        }
+
+        friend auto operator==(basic_value const &a, nullptr_t) -> bool {
+            return a.empty();
+        }
+
+        friend auto operator<(basic_value const &a, basic_value const &b)
+            -> bool {
+            if (a.empty() || b.empty())
+                return !b.empty();
+            if (a.storage.index() != b.storage.index() || !a.is_inline()) {
+                if (!a.is_inline() && !b.is_inline())
+                    return std::get<value>(a.storage) <
+                           std::get<value>(b.storage);
+                return a.type().before(b.type());
+            }
+
+            return std::visit(
+                [&](auto const &o) -> bool {
+                    using type = std::remove_cvref_t<decltype(o)>;
+                    if constexpr (std::same_as<type, std::monostate> ||
+                                  std::same_as<type, value>)
+                        return false;
+                    else
+                        return value_lt_compare(o, std::get<type>(b.storage));
+                },
+                a.storage);
+        }
+
+        friend auto operator<(basic_value const &a, value const &b) -> bool {
+            return compare(a, b) < 0;
+        }
+
+        friend auto operator<(value const &a, basic_value const &b) -> bool {
+            return compare(b, a) > 0;
+        }
+
+        friend auto operator<<(std::ostream &strm, basic_value const &v)
+            -> std::ostream & {
+            return strm << v.str();
+        }
+
+    private:
+        using storage_type = std::variant<std::monostate, Ts..., value>;
+        storage_type storage;
+
+        template <typename V> void assign(V &&v) {
+            if (v.empty())
+                return;
+
+            if (auto s = value_string_view(v)) {
+                if constexpr (detail::value_one_of<std::string, Ts...>) {
+                    storage.template emplace<std::string>(*s);
+                    return;
+                }
+            }
+
+            auto const *tag = v.object->type_tag();
+            if (!((tag == &value_type_tag<Ts> &&
+                   (storage.template emplace<Ts>(value_cast<Ts>(v)), true)) ||
+                  ...))
+                storage.template emplace<value>(std::forward<V>(v));
+        }
+
+        // Three-way comparison with an sk::value, ordered as sk::value's
+        // operator< would order them.
+        static auto compare(basic_value const &a, value const &b) -> int {
+            if (a.empty() || b.empty())
+                return int(!a.empty()) - int(!b.empty());
+
+            if (auto const *boxed = std::get_if<value>(&a.storage))
+                return *boxed < b ? -1 : (b < *boxed ? 1 : 0);
+
+            auto const &at = a.type(), &bt = b.object->type();
+            if (at != bt)
+                return at.before(bt) ? -1 : 1;
+
+            return std::visit(
+                [&](auto const &o) -> int {
+                    using type = std::remove_cvref_t<decltype(o)>;
+                    if constexpr (std::same_as<type, std::monostate> ||
+                                  std::same_as<type, value>)
+                        return 0;
+                    else {
+                        auto const &p = value_cast<type>(b);
+                        return value_lt_compare(o, p)
+                                   ? -1
+                                   : (value_lt_compare(p, o) ? 1 : 0);
+                    }
+                },
+                a.storage);
+        }
+    };
+
+    template <value_containable To, typename... Ts>
+    auto value_cast(basic_value<Ts...> const *from) -> To const * {
+        return from->template get_if<To>();
+    }
+
+    template <value_containable To, typename... Ts>
+    auto value_cast(basic_value<Ts...> const &from) -> To const & {
+        auto const *p = from.template get_if<To>();
+        if (!p)
+            throw std::bad_cast();
+        return *p;
+    }
+
+} // namespace sk
+
+template <typename... Ts> struct std::hash<sk::basic_value<Ts...>> {
+    auto operator()(sk::basic_value<Ts...> const &v) const -> std::size_t {
+        return v.hash();
+    }
+};
+
+#endif // SK_BASIC_VALUE_HXX_INCLUDED
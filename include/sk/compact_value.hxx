@@ -0,0 +1,563 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef SK_COMPACT_VALUE_HXX_INCLUDED
+#define SK_COMPACT_VALUE_HXX_INCLUDED
+
+#include <bit>
+#include <cmath>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+#include "sk/value.hxx"
+
+/*
+ * compact_value - a value in a single 64-bit word.
+ *
+ * compact_value behaves like sk::value, but is NaN-boxed: doubles are
+ * stored as themselves, and the bit patterns of the NaNs which are not
+ * otherwise used hold a tag and a 48-bit payload.  The payload holds an
+ * empty value, a bool, an int, or a std::int64_t between -2^47 and 2^47
+ * directly, so none of these allocate.  Any other object is stored in a
+ * boxed value_instance, whose address is the payload.  This needs
+ * addresses which fit in 48 bits, as they do on x86-64 and AArch64.
+ *
+ * A compact_value compares, orders and hashes exactly like an sk::value
+ * holding the same object, except that every NaN is stored as the same
+ * quiet NaN.  Since the inline objects are not stored as objects,
+ * value_cast() returns them by value; boxed objects are returned by
+ * reference as usual.
+ */
+
+namespace sk {
+    class compact_value;
+} // namespace sk
+
+// Declared before compact_value, whose operators check value_containable
+// (and so std::hash) for their argument types.
+template <> struct std::hash<sk::compact_value> {
+    auto operator()(sk::compact_value const &v) const -> std::size_t;
+};
+
+namespace sk {
+
+    static_assert(sizeof(void *) == 8, "compact_value needs 64-bit pointers");
+
+    namespace detail {
+
+        // The top 16 bits of a compact_value which is not a double.  These
+        // are all negative quiet NaNs, so no double uses them once NaNs are
+        // canonicalised.
+        enum struct compact_tag : std::uint16_t {
+            empty = 0xFFF9,
+            boolean = 0xFFFA,
+            int32 = 0xFFFB,
+            int48 = 0xFFFC,
+            boxed = 0xFFFD,
+        };
+
+        inline constexpr std::uint64_t compact_payload_mask =
+            (std::uint64_t(1) << 48) - 1;
+
+        inline constexpr std::uint64_t compact_nan = 0x7FF8'0000'0000'0000;
+
+        constexpr auto compact_bits(compact_tag tag, std::uint64_t payload)
+            -> std::uint64_t {
+            return (std::uint64_t(tag) << 48) |
+                   (payload & compact_payload_mask);
+        }
+
+        inline constexpr std::int64_t compact_int48_min =
+            -(std::int64_t(1) << 47);
+        inline constexpr std::int64_t compact_int48_max =
+            (std::int64_t(1) << 47) - 1;
+
+        // The types which a compact_value can store without boxing them.
+        template <typename T>
+        concept compact_inline =
+            std::same_as<T, double> || std::same_as<T, bool> ||
+            std::same_as<T, int> || std::same_as<T, std::int64_t>;
+
+        // value_cast() on a compact_value returns inline types by value.
+        template <typename T>
+        using compact_cast_result =
+            std::conditional_t<compact_inline<T>, T, T const &>;
+
+    } // namespace detail
+
+    class compact_value {
+    public:
+        // Create an empty value.
+        compact_value() noexcept = default;
+
+        // Create a value from a value_containable.
+        template <typename T>
+            requires(!std::same_as<std::remove_cvref_t<T>, compact_value> &&
+                     value_containable<std::remove_cvref_t<T>>)
+        explicit compact_value(T &&v) {
+            using type = std::remove_cvref_t<T>;
+            if constexpr (std::same_as<type, nullptr_t>)
+                ;
+            else if constexpr (std::same_as<type, double>)
+                set_double(v);
+            else if constexpr (std::same_as<type, bool>)
+                bits = detail::compact_bits(detail::compact_tag::boolean, v);
+            else if constexpr (std::same_as<type, int>)
+                bits = detail::compact_bits(detail::compact_tag::int32,
+                                            std::uint32_t(v));
+            else if constexpr (std::same_as<type, std::int64_t>) {
+                if (v >= detail::compact_int48_min &&
+                    v <= detail::compact_int48_max)
+                    bits = detail::compact_bits(detail::compact_tag::int48,
+                                                std::uint64_t(v));
+                else
+                    box(new value_instance<type>(v));
+            } else
+                box(new value_instance<type>(std::forward<T>(v)));
+        }
+
+        // As for sk::value, C strings are stored as std::string.
+        explicit compact_value(char const *s)
+            : compact_value(std::string(s)) {}
+
+        // Convert from an sk::value, unboxing the inline types.
+        explicit compact_value(value const &v) {
+            if (!unbox(v))
+                box(v.object->copy().release());
+        }
+
+        explicit compact_value(value &&v) {
+            if (!unbox(v))
+                box(v.object.release());
+        }
+
+        compact_value(compact_value const &other) {
+            if (other.is_boxed())
+                box(other.boxed()->copy().release());
+            else
+                bits = other.bits;
+        }
+
+        compact_value(compact_value &&other) noexcept
+            : bits(std::exchange(other.bits, empty_bits)) {}
+
+        auto operator=(compact_value const &other) -> compact_value & {
+            if (this != &other)
+                *this = compact_value(other);
+            return *this;
+        }
+
+        auto operator=(compact_value &&other) noexcept -> compact_value & {
+            if (this != &other) {
+                release();
+                bits = std::exchange(other.bits, empty_bits);
+            }
+            return *this;
+        }
+
+        ~compact_value() {
+            release();
+        }
+
+        // Convert to an sk::value.
+        auto to_value() const -> value {
+            switch (tag()) {
+            case detail::compact_tag::empty:
+                return value();
+            case detail::compact_tag::boolean:
+                return value(get_bool());
+            case detail::compact_tag::int32:
+                return value(get_int());
+            case detail::compact_tag::int48:
+                return value(get_int48());
+            case detail::compact_tag::boxed:
+                return value(value_ptr(boxed()->copy()));
+            default:
+                return value(get_double());
+            }
+        }
+
+        auto empty() const -> bool {
+            return bits == empty_bits;
+        }
+
+        // Whether the object is stored in the word itself.
+        auto is_inline() const -> bool {
+            return !is_boxed();
+        }
+
+        auto str() const -> std::string {
+            switch (tag()) {
+            case detail::compact_tag::empty:
+                return value_containable_to_string(nullptr);
+            case detail::compact_tag::boolean:
+                return value_containable_to_string(get_bool());
+            case detail::compact_tag::int32:
+                return value_containable_to_string(get_int());
+            case detail::compact_tag::int48:
+                return value_containable_to_string(get_int48());
+            case detail::compact_tag::boxed:
+                return boxed()->str();
+            default:
+                return value_containable_to_string(get_double());
+            }
+        }
+
+        auto hash() const -> std::size_t {
+            switch (tag()) {
+            case detail::compact_tag::empty:
+                return std::hash<nullptr_t>{}(nullptr);
+            case detail::compact_tag::boolean:
+                return std::hash<bool>{}(get_bool());
+            case detail::compact_tag::int32:
+                return std::hash<int>{}(get_int());
+            case detail::compact_tag::int48:
+                return std::hash<std::int64_t>{}(get_int48());
+            case detail::compact_tag::boxed:
+                return boxed()->hash();
+            default:
+                return std::hash<double>{}(get_double());
+            }
+        }
+
+        // The instance type this value behaves as; see value_base::type().
+        auto type() const -> std::type_info const & {
+            switch (tag()) {
+            case detail::compact_tag::empty:
+                return typeid(value_instance<nullptr_t>);
+            case detail::compact_tag::boolean:
+                return typeid(value_instance<bool>);
+            case detail::compact_tag::int32:
+                return typeid(value_instance<int>);
+            case detail::compact_tag::int48:
+                return typeid(value_instance<std::int64_t>);
+            case detail::compact_tag::boxed:
+                return boxed()->type();
+            default:
+                return typeid(value_instance<double>);
+            }
+        }
+
+        // A pointer to the object if it has type To and is boxed, or
+        // nullptr.  Inline objects have no address; use value_cast().
+        template <value_containable To>
+            requires(!detail::compact_inline<To>)
+        auto get_if() const -> To const * {
+            if (!is_boxed() || boxed()->type() != typeid(value_instance<To>))
+                return nullptr;
+            return static_cast<To const *>(boxed()->get());
+        }
+
+        // Store the object in out if it has type To, which is one of the
+        // inline types, and return whether it did.
+        template <value_containable To>
+            requires detail::compact_inline<To>
+        auto get(To &out) const -> bool {
+            if constexpr (std::same_as<To, double>) {
+                if (!is_double())
+                    return false;
+                out = get_double();
+            } else if constexpr (std::same_as<To, bool>) {
+                if (tag() != detail::compact_tag::boolean)
+                    return false;
+                out = get_bool();
+            } else if constexpr (std::same_as<To, int>) {
+                if (tag() != detail::compact_tag::int32)
+                    return false;
+                out = get_int();
+            } else if constexpr (std::same_as<To, std::int64_t>) {
+                if (tag() == detail::compact_tag::int48)
+                    out = get_int48();
+                else if (auto const *p = boxed_as<To>())
+                    out = *p;
+                else
+                    return false;
+            }
+            return true;
+        }
+
+        friend auto operator==(compact_value const &a, compact_value const &b)
+            -> bool {
+            if (a.is_double() && b.is_double())
+                return a.get_double() == b.get_double();
+            if (a.is_boxed() && b.is_boxed())
+                return a.boxed()->eq(b.boxed());
+            // Other inline values are equal exactly when their bits are.  A
+            // boxed object never equals an inline one, since only int64_ts
+            // which do not fit in the payload are boxed.
+            return a.bits == b.bits;
+        }
+
+        friend auto operator==(compact_value const &a, value const &b)
+            -> bool {
+            if (b.empty())
+                return a.empty();
+            if (a.is_boxed())
+                return a.boxed()->eq(b.object.get());
+            compact_value c;
+            return c.unbox(b) && a == c;
+        }
+
+        template <value_containable T>
+        friend auto operator==(compact_value const &a, T const &b) -> bool {
+            if constexpr (detail::compact_inline<T>) {
+                T o;
+                return a.get(o) && o == b;
+            } else {
+                auto const *p = a.get_if<T>();
+                return p && *p == b;
+            }
+        }
+
+        friend auto operator==(compact_value const &a, char const *b) -> bool {
+            auto const *p = a.get_if<std::string>();
+            return p && *p == b;
+        }
+
+        friend auto operator==(compact_value const &a, nullptr_t) -> bool {
+            return a.empty();
+        }
+
+        friend auto operator<(compact_value const &a, compact_value const &b)
+            -> bool {
+            return compare(a, b) < 0;
+        }
+
+        friend auto operator<(compact_value const &a, value const &b) -> bool {
+            return compare(a, b) < 0;
+        }
+
+        friend auto operator<(value const &a, compact_value const &b) -> bool {
+            return compare(b, a) > 0;
+        }
+
+        friend auto operator<<(std::ostream &strm, compact_value const &v)
+            -> std::ostream & {
+            return strm << v.str();
+        }
+
+    private:
+        static constexpr std::uint64_t empty_bits =
+            detail::compact_bits(detail::compact_tag::empty, 0);
+
+        std::uint64_t bits = empty_bits;
+
+        auto tag() const -> detail::compact_tag {
+            return detail::compact_tag(bits >> 48);
+        }
+
+        auto is_double() const -> bool {
+            return bits < empty_bits;
+        }
+
+        auto is_boxed() const -> bool {
+            return tag() == detail::compact_tag::boxed;
+        }
+
+        auto get_double() const -> double {
+            return std::bit_cast<double>(bits);
+        }
+
+        auto get_bool() const -> bool {
+            return (bits & 1) != 0;
+        }
+
+        auto get_int() const -> int {
+            return int(std::uint32_t(bits));
+        }
+
+        // Sign-extend the 48-bit payload.
+        auto get_int48() const -> std::int64_t {
+            return std::int64_t(bits << 16) >> 16;
+        }
+
+        auto boxed() const -> value_base * {
+            return reinterpret_cast<value_base *>(
+                std::uintptr_t(bits & detail::compact_payload_mask));
+        }
+
+        template <typename To> auto boxed_as() const -> To const * {
+            if (!is_boxed() || boxed()->type() != typeid(value_instance<To>))
+                return nullptr;
+            return static_cast<To const *>(boxed()->get());
+        }
+
+        void set_double(double d) {
+            bits = std::isnan(d) ? detail::compact_nan
+                                 : std::bit_cast<std::uint64_t>(d);
+        }
+
+        // Take ownership of a boxed object.
+        void box(value_base *p) {
+            auto address = std::uint64_t(reinterpret_cast<std::uintptr_t>(p));
+            if (address & ~detail::compact_payload_mask) {
+                p->destroy();
+                throw std::runtime_error(
+                    "compact_value: address does not fit in 48 bits");
+            }
+            bits = detail::compact_bits(detail::compact_tag::boxed, address);
+        }
+
+        void release() noexcept {
+            if (is_boxed())
+                boxed()->destroy();
+            bits = empty_bits;
+        }
+
+        // Store v inline if it has an inline type; otherwise leave this
+        // empty and return false.
+        auto unbox(value const &v) -> bool {
+            if (v.empty())
+                return true;
+
+            auto const *tag = v.object->type_tag();
+            if (tag == &value_type_tag<double>)
+                set_double(value_cast<double>(v));
+            else if (tag == &value_type_tag<bool>)
+                *this = compact_value(value_cast<bool>(v));
+            else if (tag == &value_type_tag<int>)
+                *this = compact_value(value_cast<int>(v));
+            else if (tag == &value_type_tag<std::int64_t>) {
+                auto i = value_cast<std::int64_t>(v);
+                if (i < detail::compact_int48_min ||
+                    i > detail::compact_int48_max)
+                    return false;
+                *this = compact_value(i);
+            } else
+                return false;
+            return true;
+        }
+
+        // Three-way comparison, ordered as sk::value's operator< would
+        // order the same objects.
+        static auto compare(compact_value const &a, compact_value const &b)
+            -> int {
+            if (a.empty() || b.empty())
+                return int(!a.empty()) - int(!b.empty());
+
+            if (a.is_double() && b.is_double())
+                return three_way(a.get_double(), b.get_double());
+
+            auto const &at = a.type(), &bt = b.type();
+            if (at != bt)
+                return at.before(bt) ? -1 : 1;
+
+            if (a.is_boxed() && b.is_boxed())
+                return a.boxed()->lt(b.boxed())
+                           ? -1
+                           : (b.boxed()->lt(a.boxed()) ? 1 : 0);
+
+            // Both are of the same inline type, though an int64_t may be
+            // boxed in one and inline in the other.
+            switch (a.type_tag()) {
+            case detail::compact_tag::boolean:
+                return three_way(a.get_bool(), b.get_bool());
+            case detail::compact_tag::int32:
+                return three_way(a.get_int(), b.get_int());
+            default: {
+                std::int64_t x, y;
+                a.get(x), b.get(y);
+                return three_way(x, y);
+            }
+            }
+        }
+
+        static auto compare(compact_value const &a, value const &b) -> int {
+            if (a.empty() || b.empty())
+                return int(!a.empty()) - int(!b.empty());
+
+            auto const &at = a.type(), &bt = b.object->type();
+            if (at != bt)
+                return at.before(bt) ? -1 : 1;
+
+            if (a.is_boxed())
+                return a.boxed()->lt(b.object.get())
+                           ? -1
+                           : (b.object->lt(a.boxed()) ? 1 : 0);
+
+            // b has the same, inline, type as a, so this does not allocate
+            // unless b is an int64_t which is too large to be inline.
+            return compare(a, compact_value(b));
+        }
+
+        // The tag of an inline value, or the inline tag its boxed object
+        // would have if it fitted.
+        auto type_tag() const -> detail::compact_tag {
+            if (is_boxed() &&
+                boxed()->type_tag() == &value_type_tag<std::int64_t>)
+                return detail::compact_tag::int48;
+            return tag();
+        }
+
+        template <typename T> static auto three_way(T x, T y) -> int {
+            return x < y ? -1 : (y < x ? 1 : 0);
+        }
+    };
+
+    static_assert(sizeof(compact_value) == 8);
+
+    template <value_containable To>
+    auto value_cast(compact_value const *from) -> To const *
+        requires(!detail::compact_inline<To>) {
+        return from->template get_if<To>();
+    }
+
+    template <value_containable To>
+    auto value_cast(compact_value const &from)
+        -> detail::compact_cast_result<To> {
+        if constexpr (detail::compact_inline<To>) {
+            To o;
+            if (!from.get(o))
+                throw std::bad_cast();
+            return o;
+        } else {
+            auto const *p = from.template get_if<To>();
+            if (!p)
+                throw std::bad_cast();
+            return *p;
+        }
+    }
+
+} // namespace sk
+
+inline auto std::hash<sk::compact_value>::operator()(
+    sk::compact_value const &v) const -> std::size_t {
+    return v.hash();
+}
+
+#endif // SK_COMPACT_VALUE_HXX_INCLUDED
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef SK_CONCURRENT_VALUE_MAP_HXX_INCLUDED
+#define SK_CONCURRENT_VALUE_MAP_HXX_INCLUDED
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <thread>
+#include <utility>
+
+#include "sk/value.hxx"
+#include "sk/value_flat_map.hxx"
+
+/*
+ * concurrent_value_map - a hash map from sk::value to V which can be used
+ * from several threads at once.
+ *
+ * The map is split into a power-of-two number of shards, each a
+ * value_flat_map guarded by its own reader-writer lock and kept on its own
+ * cache lines.  A key's shard is chosen from the top bits of its hash, so
+ * threads working on different keys rarely touch the same lock, and readers
+ * of the same shard only take it shared.
+ *
+ * Lookup is heterogeneous, as for value_flat_map: keys may be given as
+ * sk::value, as any containable type, or as std::string_view or char const *
+ * for string keys.
+ *
+ * Since other threads may modify the map at any time, no references or
+ * iterators into it are handed out.  find() returns a copy of the mapped
+ * value; visit() and update() call a function on it while the shard is
+ * locked, and the function must not use the map itself.
+ */
+
+namespace sk {
+
+    template <typename V> class concurrent_value_map {
+    public:
+        using key_type = value;
+        using mapped_type = V;
+        using size_type = std::size_t;
+
+        // Use at least the given number of shards, rounded up to a power of
+        // two.  The default is four per hardware thread.
+        explicit concurrent_value_map(size_type shard_count = 0) {
+            if (shard_count == 0)
+                shard_count =
+                    4 * std::max(1u, std::thread::hardware_concurrency());
+            shard_count = std::bit_ceil(shard_count);
+            shard_bits = std::countr_zero(shard_count);
+            shards = std::make_unique<shard[]>(shard_count);
+        }
+
+        concurrent_value_map(concurrent_value_map const &) = delete;
+        auto operator=(concurrent_value_map const &)
+            -> concurrent_value_map & = delete;
+
+        auto shard_count() const -> size_type {
+            return size_type(1) << shard_bits;
+        }
+
+        // The number of elements.  Only a snapshot if other threads are
+        // modifying the map.
+        auto size() const -> size_type {
+            size_type n = 0;
+            for (size_type i = 0; i < shard_count(); ++i) {
+                std::shared_lock lock(shards[i].mutex);
+                n += shards[i].map.size();
+            }
+            return n;
+        }
+
+        auto empty() const -> bool {
+            return size() == 0;
+        }
+
+        template <typename K> auto contains(K const &key) const -> bool {
+            auto const &s = shard_for(key);
+            std::shared_lock lock(s.mutex);
+            return s.map.contains(key);
+        }
+
+        // Return a copy of the value mapped to key.
+        template <typename K>
+        auto find(K const &key) const -> std::optional<V> {
+            auto const &s = shard_for(key);
+            std::shared_lock lock(s.mutex);
+            auto it = s.map.find(key);
+            if (it == s.map.end())
+                return std::nullopt;
+            return it->second;
+        }
+
+        // Call f(V const &) with the value mapped to key, under a shared
+        // lock.  Returns false if the key is not present.
+        template <typename K, typename F>
+        auto visit(K const &key, F &&f) const -> bool {
+            auto const &s = shard_for(key);
+            std::shared_lock lock(s.mutex);
+            auto it = s.map.find(key);
+            if (it == s.map.end())
+                return false;
+            std::forward<F>(f)(std::as_const(it->second));
+            return true;
+        }
+
+        // Call f(V &) with the value mapped to key, under an exclusive lock.
+        // Returns false if the key is not present.
+        template <typename K, typename F>
+        auto update(K const &key, F &&f) -> bool {
+            auto &s = shard_for(key);
+            std::unique_lock lock(s.mutex);
+            auto it = s.map.find(key);
+            if (it == s.map.end())
+                return false;
+            std::forward<F>(f)(it->second);
+            return true;
+        }
+
+        // Insert key => V(args...) if the key is not present.  Returns true
+        // if it was inserted.
+        template <typename K, typename... Args>
+        auto try_emplace(K &&key, Args &&...args) -> bool {
+            auto &s = shard_for(key);
+            std::unique_lock lock(s.mutex);
+            return s.map
+                .try_emplace(std::forward<K>(key), std::forward<Args>(args)...)
+                .second;
+        }
+
+        template <typename K> auto insert(K &&key, V const &v) -> bool {
+            return try_emplace(std::forward<K>(key), v);
+        }
+
+        template <typename K> auto insert(K &&key, V &&v) -> bool {
+            return try_emplace(std::forward<K>(key), std::move(v));
+        }
+
+        // Insert or replace the value mapped to key.  Returns true if it was
+        // inserted.
+        template <typename K, typename M>
+        auto insert_or_assign(K &&key, M &&m) -> bool {
+            auto &s = shard_for(key);
+            std::unique_lock lock(s.mutex);
+            return s.map
+                .insert_or_assign(std::forward<K>(key), std::forward<M>(m))
+                .second;
+        }
+
+        template <typename K> auto erase(K const &key) -> size_type {
+            auto &s = shard_for(key);
+            std::unique_lock lock(s.mutex);
+            return s.map.erase(key);
+        }
+
+        void clear() {
+            for (size_type i = 0; i < shard_count(); ++i) {
+                std::unique_lock lock(shards[i].mutex);
+                shards[i].map.clear();
+            }
+        }
+
+        // Call f(value const &, V const &) for every element, locking one
+        // shard at a time.
+        template <typename F> void for_each(F &&f) const {
+            for (size_type i = 0; i < shard_count(); ++i) {
+                std::shared_lock lock(shards[i].mutex);
+                for (auto const &[k, v] : shards[i].map)
+                    f(k, v);
+            }
+        }
+
+    private:
+        struct alignas(64) shard {
+            mutable std::shared_mutex mutex;
+            value_flat_map<V> map;
+        };
+
+        int shard_bits = 0;
+        std::unique_ptr<shard[]> shards;
+
+        // The table uses the low bits of the mixed hash, so the shard is
+        // taken from the high bits.
+        template <typename K>
+        auto shard_index(K const &key) const -> size_type {
+            if (shard_bits == 0)
+                return 0;
+            auto h = detail::value_flat_mix(detail::value_flat_hash{}(key));
+            return static_cast<size_type>(h >> (64 - shard_bits));
+        }
+
+        template <typename K>
+        auto shard_for(K const &key) const -> shard const & {
+            return shards[shard_index(key)];
+        }
+
+        template <typename K> auto shard_for(K const &key) -> shard & {
+            return shards[shard_index(key)];
+        }
+    };
+
+} // namespace sk
+
+#endif // SK_CONCURRENT_VALUE_MAP_HXX_INCLUDED
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SK_LAZY_VALUE_HXX_INCLUDED
+#define SK_LAZY_VALUE_HXX_INCLUDED
+
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "sk/value.hxx"
+
+/*
+ * lazy_value - a value which is decoded the first time it is used.
+ *
+ * A lazy_value holds the raw bytes of a value and a function to decode them.
+ * Nothing is decoded until the value is compared, hashed, cast or printed;
+ * the decoded value is then kept and the bytes are released, so the cost of
+ * decoding is only paid for values which are actually used.
+ *
+ * Decoding happens inside const member functions but is not synchronised:
+ * as with other lazily initialised objects, a lazy_value which has not been
+ * decoded yet must not be used from several threads at once.  Call get()
+ * first to share it.
+ */
+
+namespace sk {
+
+    class lazy_value {
+    public:
+        using decoder = std::function<value(std::span<std::byte const>)>;
+
+        // An empty value; nothing to decode.
+        lazy_value() : decoded(std::in_place) {}
+
+        // A value which has already been decoded.
+        explicit lazy_value(value v) : decoded(std::move(v)) {}
+
+        lazy_value(std::vector<std::byte> bytes, decoder decode)
+            : bytes(std::move(bytes)), decode(std::move(decode)) {}
+
+        lazy_value(std::span<std::byte const> bytes, decoder decode)
+            : bytes(bytes.begin(), bytes.end()), decode(std::move(decode)) {}
+
+        // Whether the value has been decoded yet.
+        auto is_decoded() const -> bool {
+            return decoded.has_value();
+        }
+
+        // The undecoded bytes; empty once the value has been decoded.
+        auto raw() const -> std::span<std::byte const> {
+            return bytes;
+        }
+
+        // The decoded value.
+        auto get() const -> value const & {
+            if (!decoded) {
+                decoded = decode(bytes);
+                std::vector<std::byte>().swap(bytes);
+                decode = nullptr;
+            }
+            return *decoded;
+        }
+
+        operator value const &() const {
+            return get();
+        }
+
+        auto empty() const -> bool {
+            return get().empty();
+        }
+
+        auto str() const -> std::string {
+            return get().str();
+        }
+
+    private:
+        mutable std::vector<std::byte> bytes;
+        mutable decoder decode;
+        mutable std::optional<value> decoded;
+    };
+
+    template <value_containable To>
+    auto value_cast(lazy_value const *from) -> To const * {
+        return value_cast<To>(&from->get());
+    }
+
+    template <value_containable To>
+    auto value_cast(lazy_value const &from) -> To const & {
+        return value_cast<To>(from.get());
+    }
+
+    inline auto operator==(lazy_value const &a, lazy_value const &b) -> bool {
+        return a.get() == b.get();
+    }
+
+    inline auto operator==(lazy_value const &a, value const &b) -> bool {
+        return a.get() == b;
+    }
+
+    template <value_containable T>
+    inline auto operator==(lazy_value const &a, T const &b) -> bool {
+        return a.get() == b;
+    }
+
+    inline auto operator==(lazy_value const &a, char const *b) -> bool {
+        return a.get() == b;
+    }
+
+    inline auto operator<(lazy_value const &a, lazy_value const &b) -> bool {
+        return a.get() < b.get();
+    }
+
+    inline auto operator<(lazy_value const &a, value const &b) -> bool {
+        return a.get() < b;
+    }
+
+    inline auto operator<(value const &a, lazy_value const &b) -> bool {
+        return a < b.get();
+    }
+
+    inline auto operator<<(std::ostream &strm, lazy_value const &v)
+        -> std::ostream & {
+        return strm << v.get();
+    }
+
+} // namespace sk
+
+template <> struct std::hash<sk::lazy_value> {
+    auto operator()(sk::lazy_value const &v) const -> std::size_t {
+        return std::hash<sk::value>{}(v.get());
+    }
+};
+
+#endif // SK_LAZY_VALUE_HXX_INCLUDED
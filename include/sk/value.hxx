@@ -29,22 +29,48 @@
 #ifndef SK_VALUE_HXX_INCLUDED
 #define SK_VALUE_HXX_INCLUDED
 
+#include <algorithm>
+#include <atomic>
 #include <concepts>
 #include <cstddef>
+#include <cstring>
 #include <functional>
 #include <iostream>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ranges>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <type_traits>
+#include <typeinfo>
+#include <utility>
 
 /*
  * value - type-erased polymorphic scalars.
  */
 
+// Operation counters; see sk/value_stats.hxx.
+#ifdef SK_VALUE_STATS
+#    include "sk/value_stats.hxx"
+#    define SK_VALUE_COUNT(counter, type)                                      \
+        ::sk::detail::value_stats_count(&::sk::value_stats::counter, type)
+#else
+#    define SK_VALUE_COUNT(counter, type) ((void)0)
+#endif
+
 namespace sk {
 
     struct value;
 
+    // Thrown when encoded values (binary, JSON and so on) are malformed or
+    // contain a type which cannot be read or written.
+    struct value_format_error : std::runtime_error {
+        using std::runtime_error::runtime_error;
+    };
+
     // clang-format off
     template<typename T>
     concept value_containable = 
@@ -75,7 +101,7 @@ namespace sk {
 
     template <value_containable T>
     auto value_containable_to_string(T const &v) -> std::string
-        requires !value_printable<T> {
+        requires(!value_printable<T>) {
         return "<value>";
     }
 
@@ -87,10 +113,60 @@ namespace sk {
 
     template <value_containable T>
     auto value_lt_compare(T const &a, T const &b)
-        -> bool requires !value_lt_comparable<T> {
+        -> bool requires(!value_lt_comparable<T>) {
         return false;
     }
 
+    // Memory owned by a std::basic_string outside of the string object
+    // itself: none for a short string stored inline, otherwise its buffer.
+    template <typename Char, typename Traits, typename Alloc>
+    auto value_heap_usage(std::basic_string<Char, Traits, Alloc> const &s)
+        -> std::size_t {
+        auto const *data = reinterpret_cast<char const *>(s.data());
+        auto const *self = reinterpret_cast<char const *>(&s);
+        std::less<> before;
+        if (!before(data, self) && before(data, self + sizeof(s)))
+            return 0;
+        return (s.capacity() + 1) * sizeof(Char);
+    }
+
+    namespace detail {
+
+        // The memory an object owns outside of sizeof(T).  Types which own
+        // memory can say how much by providing a value_heap_usage() which
+        // is found by argument-dependent lookup; anything else owns none.
+        template <typename T>
+        auto value_heap_usage_of(T const &o) -> std::size_t {
+            if constexpr (requires {
+                              { value_heap_usage(o) } -> std::convertible_to<std::size_t>;
+                          })
+                return value_heap_usage(o);
+            else
+                return 0;
+        }
+
+    } // namespace detail
+
+    // A distinct address for each type, which identifies it more cheaply
+    // than its std::type_info.
+    template <typename T> inline constexpr char value_type_tag = 0;
+
+    // Whether T's operator== compares exactly the bytes of the objects.
+    // This is true of integers and pointers; other types, whose operator==
+    // may do anything, can opt in by specialising it:
+    //
+    //   template <> inline constexpr bool value_bytewise_equal<point> = true;
+    template <typename T>
+    inline constexpr bool value_bytewise_equal =
+        std::is_integral_v<T> || std::is_pointer_v<T>;
+
+    // Types whose objects are equal exactly when their bytes are, so they
+    // can be compared as raw memory.
+    template <typename T>
+    concept value_trivial = value_bytewise_equal<T> and
+                            std::is_trivially_copyable_v<T> and
+                            std::has_unique_object_representations_v<T>;
+
     struct value_base {
         virtual ~value_base() = default;
         virtual auto copy() const -> std::unique_ptr<value_base> = 0;
@@ -98,15 +174,121 @@ namespace sk {
         virtual auto str() const -> std::string = 0;
         virtual auto eq(value_base const *other) const -> bool = 0;
         virtual auto lt(value_base const *other) const -> bool = 0;
+
+        // The type which identifies and orders this value: the dynamic
+        // type of the value_instance holding the object.  Objects stored
+        // some other way, like borrowed strings, report the instance type
+        // they behave as.
+        virtual auto type() const -> std::type_info const & = 0;
+
+        // A pointer to the stored object, whose type is given by type().
+        virtual auto get() const -> void const * = 0;
+
+        // &value_type_tag<T>, where T is the type of the stored object as
+        // given by type().
+        virtual auto type_tag() const -> void const * = 0;
+
+        // The memory allocated for this object and anything it owns.
+        // Objects which are not owned by a value, like constants, report 0.
+        virtual auto memory_usage() const -> std::size_t = 0;
+
+        // Release the object when the last value referring to it goes
+        // away.  Objects with static storage duration, like constants,
+        // override this to do nothing.
+        constexpr virtual void destroy() noexcept {
+            delete this;
+        }
     };
 
+    /*
+     * A std::string value whose characters are owned by someone else; see
+     * value::borrow().  It compares and hashes exactly like an owned
+     * std::string, and copying it makes an owned copy.
+     */
+    struct value_borrowed_string final : value_base {
+        std::string_view view;
+
+        constexpr explicit value_borrowed_string(std::string_view s,
+                                                 bool is_constant = false)
+            : view(s), is_constant(is_constant) {
+            if (!is_constant)
+                SK_VALUE_COUNT(allocations, this);
+        }
+
+        constexpr void destroy() noexcept final {
+            if (!is_constant)
+                delete this;
+        }
+
+        auto copy() const -> std::unique_ptr<value_base> final;
+
+        auto hash() const -> std::size_t final {
+            return std::hash<std::string_view>{}(view);
+        }
+
+        auto str() const -> std::string final {
+            return std::string(view);
+        }
+
+        auto eq(value_base const *other) const -> bool final;
+        auto lt(value_base const *other) const -> bool final;
+        auto type() const -> std::type_info const & final;
+
+        auto type_tag() const -> void const * final {
+            return &value_type_tag<std::string>;
+        }
+
+        // The borrowed characters belong to someone else, but the copy made
+        // by get() is ours.
+        auto memory_usage() const -> std::size_t final {
+            if (is_promoted.load(std::memory_order_acquire))
+                return sizeof(*this) + value_heap_usage(*promoted);
+            return sizeof(*this);
+        }
+
+        // Casting to std::string needs a std::string object; make one the
+        // first time it is asked for.
+        auto get() const -> void const * final {
+            std::call_once(promote_once, [this] {
+                promoted.emplace(view);
+                is_promoted.store(true, std::memory_order_release);
+            });
+            return &*promoted;
+        }
+
+    private:
+        bool is_constant;
+        mutable std::once_flag promote_once;
+        mutable std::optional<std::string> promoted;
+        mutable std::atomic<bool> is_promoted{false};
+    };
+
+    namespace detail {
+
+        // Equality for value_trivial types, shared by every type of the
+        // same size: the same type and the same bytes.  Type tags are
+        // compared first since that is cheap, but a type can have more than
+        // one tag when it is used from several shared libraries, so
+        // different tags fall back to comparing the types.
+        template <std::size_t Size>
+        auto value_trivial_eq(value_base const *a, value_base const *b)
+            -> bool {
+            if (a->type_tag() != b->type_tag() && a->type() != b->type())
+                return false;
+            return std::memcmp(a->get(), b->get(), Size) == 0;
+        }
+
+    } // namespace detail
+
     template <typename T> struct value_instance final : value_base {
         T object;
 
         // Construct a new value.
         template <typename... Args>
         explicit value_instance(Args &&...args)
-            : object(std::forward<Args>(args)...) {}
+            : object(std::forward<Args>(args)...) {
+            SK_VALUE_COUNT(allocations, typeid(value_instance));
+        }
 
         auto copy() const -> std::unique_ptr<value_base> final {
             return std::make_unique<value_instance>(object);
@@ -121,27 +303,247 @@ namespace sk {
         }
 
         auto eq(value_base const *other) const -> bool final {
-            auto const *p = dynamic_cast<value_instance<T> const *>(other);
-            if (!p)
-                return false;
-            return object == p->object;
+            // Trivial objects are compared as bytes, which does not need to
+            // know the other value's dynamic type.
+            if constexpr (value_trivial<T>) {
+                return detail::value_trivial_eq<sizeof(T)>(this, other);
+            } else {
+                auto const *p = dynamic_cast<value_instance<T> const *>(other);
+                if (!p) {
+                    if constexpr (std::same_as<T, std::string>) {
+                        if (auto const *b = dynamic_cast<
+                                value_borrowed_string const *>(other))
+                            return object == b->view;
+                    }
+                    // A constant of the same type.
+                    if (other->type_tag() == &value_type_tag<T>)
+                        return object ==
+                               *static_cast<T const *>(other->get());
+                    return false;
+                }
+                return object == p->object;
+            }
         }
 
         auto lt(value_base const *other) const -> bool final {
             auto const *p = dynamic_cast<value_instance<T> const *>(other);
-            if (!p)
+            if (!p) {
+                if constexpr (std::same_as<T, std::string>) {
+                    if (auto const *b =
+                            dynamic_cast<value_borrowed_string const *>(other))
+                        return std::string_view(object) < b->view;
+                }
+                if (other->type_tag() == &value_type_tag<T>)
+                    return value_lt_compare(
+                        object, *static_cast<T const *>(other->get()));
                 return false;
+            }
             return value_lt_compare(object, p->object);
         }
+
+        auto type() const -> std::type_info const & final {
+            return typeid(value_instance);
+        }
+
+        auto get() const -> void const * final {
+            return &object;
+        }
+
+        auto type_tag() const -> void const * final {
+            return &value_type_tag<T>;
+        }
+
+        auto memory_usage() const -> std::size_t final {
+            return sizeof(*this) + detail::value_heap_usage_of(object);
+        }
+    };
+
+    /*
+     * An object with static storage duration, created by value::constant().
+     * It behaves exactly like a value_instance<T> holding the same object,
+     * but is never freed, and copying it makes an ordinary value_instance.
+     */
+    template <typename T> struct value_constant_instance final : value_base {
+        T object;
+
+        constexpr explicit value_constant_instance(T const &v) : object(v) {}
+
+        auto copy() const -> std::unique_ptr<value_base> final {
+            return std::make_unique<value_instance<T>>(object);
+        }
+
+        auto hash() const -> std::size_t final {
+            return std::hash<T>{}(object);
+        }
+
+        auto str() const -> std::string final {
+            return value_containable_to_string(object);
+        }
+
+        auto eq(value_base const *other) const -> bool final {
+            return other->type_tag() == &value_type_tag<T> &&
+                   object == *static_cast<T const *>(other->get());
+        }
+
+        auto lt(value_base const *other) const -> bool final {
+            return other->type_tag() == &value_type_tag<T> &&
+                   value_lt_compare(object,
+                                    *static_cast<T const *>(other->get()));
+        }
+
+        auto type() const -> std::type_info const & final {
+            return typeid(value_instance<T>);
+        }
+
+        auto get() const -> void const * final {
+            return &object;
+        }
+
+        auto type_tag() const -> void const * final {
+            return &value_type_tag<T>;
+        }
+
+        auto memory_usage() const -> std::size_t final {
+            return 0;
+        }
+
+        constexpr void destroy() noexcept final {}
+    };
+
+    /*
+     * The owning pointer from a value to its object.  Objects are released
+     * through value_base::destroy(), which lets values refer to constants
+     * without freeing them.
+     */
+    class value_ptr {
+    public:
+        constexpr value_ptr() noexcept = default;
+        constexpr value_ptr(nullptr_t) noexcept {}
+        constexpr explicit value_ptr(value_base *p) noexcept : p(p) {}
+
+        template <std::derived_from<value_base> U>
+        value_ptr(std::unique_ptr<U> &&u) noexcept : p(u.release()) {}
+
+        constexpr value_ptr(value_ptr &&other) noexcept
+            : p(std::exchange(other.p, nullptr)) {}
+
+        value_ptr(value_ptr const &) = delete;
+
+        constexpr ~value_ptr() {
+            if (p)
+                p->destroy();
+        }
+
+        constexpr auto operator=(value_ptr &&other) noexcept -> value_ptr & {
+            reset(std::exchange(other.p, nullptr));
+            return *this;
+        }
+
+        template <std::derived_from<value_base> U>
+        auto operator=(std::unique_ptr<U> &&u) noexcept -> value_ptr & {
+            reset(u.release());
+            return *this;
+        }
+
+        constexpr auto operator=(nullptr_t) noexcept -> value_ptr & {
+            reset();
+            return *this;
+        }
+
+        constexpr void reset(value_base *q = nullptr) noexcept {
+            if (auto *old = std::exchange(p, q))
+                old->destroy();
+        }
+
+        constexpr auto get() const noexcept -> value_base * {
+            return p;
+        }
+
+        // Give up ownership of the object without releasing it.
+        constexpr auto release() noexcept -> value_base * {
+            return std::exchange(p, nullptr);
+        }
+
+        constexpr auto operator->() const noexcept -> value_base * {
+            return p;
+        }
+
+        constexpr auto operator*() const noexcept -> value_base & {
+            return *p;
+        }
+
+        constexpr explicit operator bool() const noexcept {
+            return p != nullptr;
+        }
+
+    private:
+        value_base *p = nullptr;
+    };
+
+    // A string literal as a template argument, for value::constant().
+    template <std::size_t N> struct value_fixed_string {
+        char chars[N];
+
+        constexpr value_fixed_string(char const (&s)[N]) {
+            std::copy_n(s, N, chars);
+        }
+
+        constexpr auto view() const -> std::string_view {
+            return {chars, N - 1};
+        }
     };
 
+    namespace detail {
+
+        template <auto V>
+        inline constinit value_constant_instance<decltype(V)>
+            value_constant_object{V};
+
+        template <value_fixed_string S>
+        inline constinit value_borrowed_string value_constant_string{
+            S.view(), true};
+
+    } // namespace detail
+
+    inline auto value_borrowed_string::copy() const
+        -> std::unique_ptr<value_base> {
+        return std::make_unique<value_instance<std::string>>(view);
+    }
+
+    inline auto value_borrowed_string::eq(value_base const *other) const
+        -> bool {
+        if (auto const *p =
+                dynamic_cast<value_instance<std::string> const *>(other))
+            return view == p->object;
+        if (auto const *b = dynamic_cast<value_borrowed_string const *>(other))
+            return view == b->view;
+        return false;
+    }
+
+    inline auto value_borrowed_string::lt(value_base const *other) const
+        -> bool {
+        if (auto const *p =
+                dynamic_cast<value_instance<std::string> const *>(other))
+            return view < p->object;
+        if (auto const *b = dynamic_cast<value_borrowed_string const *>(other))
+            return view < b->view;
+        return false;
+    }
+
+    inline auto value_borrowed_string::type() const
+        -> std::type_info const & {
+        return typeid(value_instance<std::string>);
+    }
+
     /*
      * The value.
      */
     struct value {
         // Create an empty value.
         value()
-            : object(std::make_unique<value_instance<nullptr_t>>(nullptr)) {}
+            : object(std::make_unique<value_instance<nullptr_t>>(nullptr)) {
+            SK_VALUE_COUNT(constructions, typeid(value_instance<nullptr_t>));
+        }
 
         // Create a value from a value_containable.
         template <typename T>
@@ -149,27 +551,70 @@ namespace sk {
                 typename std::remove_cvref<T>::type>
             : object(std::make_unique<
                      value_instance<typename std::remove_cvref<T>::type>>(
-                  std::forward<T>(v))) {}
+                  std::forward<T>(v))) {
+            SK_VALUE_COUNT(constructions, object.get());
+        }
 
         // A value created from a C string should be stored
         // as an std::basic_string for consistency.
         explicit value(char const *s)
-            : object(std::make_unique<value_instance<std::string>>(s)) {}
+            : object(std::make_unique<value_instance<std::string>>(s)) {
+            SK_VALUE_COUNT(constructions, object.get());
+        }
         explicit value(wchar_t const *s)
-            : object(std::make_unique<value_instance<std::wstring>>(s)) {}
+            : object(std::make_unique<value_instance<std::wstring>>(s)) {
+            SK_VALUE_COUNT(constructions, object.get());
+        }
         explicit value(char8_t const *s)
-            : object(std::make_unique<value_instance<std::u8string>>(s)) {}
+            : object(std::make_unique<value_instance<std::u8string>>(s)) {
+            SK_VALUE_COUNT(constructions, object.get());
+        }
         explicit value(char16_t const *s)
-            : object(std::make_unique<value_instance<std::u16string>>(s)) {}
+            : object(std::make_unique<value_instance<std::u16string>>(s)) {
+            SK_VALUE_COUNT(constructions, object.get());
+        }
         explicit value(char32_t const *s)
-            : object(std::make_unique<value_instance<std::u32string>>(s)) {}
+            : object(std::make_unique<value_instance<std::u32string>>(s)) {
+            SK_VALUE_COUNT(constructions, object.get());
+        }
+
+        // Take ownership of an existing instance.
+        explicit value(std::unique_ptr<value_base> instance) noexcept
+            : object(std::move(instance)) {
+            SK_VALUE_COUNT(constructions, object.get());
+        }
+
+        constexpr explicit value(value_ptr instance) noexcept
+            : object(std::move(instance)) {
+            if (!std::is_constant_evaluated())
+                SK_VALUE_COUNT(constructions, object.get());
+        }
+
+        // Create a std::string value which refers to s instead of copying
+        // it.  The characters must outlive the value and anything it is
+        // moved to, and must not change while it refers to them; copying
+        // the value, or calling detach(), makes an owned copy of the
+        // string.
+        static auto borrow(std::string_view s) -> value {
+            return value(std::unique_ptr<value_base>(
+                std::make_unique<value_borrowed_string>(s)));
+        }
 
         // Copy a value.
         value(value const &other)
-            : object(other.object ? other.object->copy() : nullptr) {}
+            : object(other.object ? other.object->copy() : nullptr) {
+            SK_VALUE_COUNT(constructions, object.get());
+            SK_VALUE_COUNT(copies, object.get());
+        }
 
         // Move a value
-        value(value &&other) noexcept : object(std::move(other.object)) {}
+        constexpr value(value &&other) noexcept
+            : object(std::move(other.object)) {
+            if (!std::is_constant_evaluated()) {
+                SK_VALUE_COUNT(constructions, object.get());
+                SK_VALUE_COUNT(moves, object.get());
+            }
+        }
 
         // Assign a value from a value_containable.
         template <typename T>
@@ -184,34 +629,60 @@ namespace sk {
 
         auto operator=(char const *s) -> value & {
             object = std::make_unique<value_instance<std::string>>(s);
+            return *this;
         }
 
         auto operator=(wchar_t const *s) -> value & {
             object = std::make_unique<value_instance<std::wstring>>(s);
+            return *this;
         }
 
         auto operator=(char8_t const *s) -> value & {
             object = std::make_unique<value_instance<std::u8string>>(s);
+            return *this;
         }
 
         auto operator=(char16_t const *s) -> value & {
             object = std::make_unique<value_instance<std::u16string>>(s);
+            return *this;
         }
 
         auto operator=(char32_t const *s) -> value & {
             object = std::make_unique<value_instance<std::u32string>>(s);
+            return *this;
         }
 
         auto operator=(value const &other) {
             object = other.object ? other.object->copy() : nullptr;
+            SK_VALUE_COUNT(copies, object.get());
         }
 
         auto operator=(value &&other) noexcept {
             object = std::move(other.object);
+            SK_VALUE_COUNT(moves, object.get());
+        }
+
+        // Refer to a constant with static storage duration.  This does not
+        // allocate, and can be used to initialise constinit values:
+        //
+        //   constinit sk::value zero = sk::value::constant<0>();
+        //   constinit sk::value na = sk::value::constant<"N/A">();
+        //
+        // String constants behave as std::string values, like value("...").
+        template <auto V>
+            requires(value_containable<decltype(V)> &&
+                     !std::is_pointer_v<decltype(V)>)
+        static constexpr auto constant() -> value {
+            return value(value_ptr(&detail::value_constant_object<V>));
+        }
+
+        template <value_fixed_string S>
+        static constexpr auto constant() -> value {
+            return value(value_ptr(&detail::value_constant_string<S>));
         }
 
         // The stored value.
-        std::unique_ptr<value_base> object;
+        value_ptr object;
 
         auto empty() const -> bool {
             static value_instance<nullptr_t> null_value;
@@ -219,28 +690,87 @@ namespace sk {
         }
 
         auto str() const -> std::string {
+            SK_VALUE_COUNT(string_conversions, object.get());
             return object->str();
         }
+
+        // Make the value own its contents if it was created by borrow().
+        void detach() {
+            if (dynamic_cast<value_borrowed_string const *>(object.get()))
+                object = object->copy();
+        }
     };
 
+    namespace detail {
+
+        // Almost every stored object is exactly a value_instance<T>, so
+        // comparing the dynamic type is enough to identify it and the cast
+        // itself can be a static_cast.  Anything else, like a borrowed
+        // string, is asked for its object through type() and get().  An
+        // empty value never casts to anything.
+        //
+        // This is value_cast without counting failures, for the library's
+        // own probing of a value's type.
+        template <value_containable To>
+        auto value_probe(value const *from) -> To const * {
+            if constexpr (std::same_as<To, nullptr_t>)
+                return nullptr;
+
+            auto const &instance_type = typeid(value_instance<To>);
+            if (typeid(*from->object) == instance_type)
+                return &static_cast<value_instance<To> const *>(
+                            from->object.get())
+                            ->object;
+
+            if (from->object->type() == instance_type)
+                return static_cast<To const *>(from->object->get());
+
+            return nullptr;
+        }
+
+    } // namespace detail
+
     template <value_containable To>
     auto value_cast(value const *from) -> To const * {
-        if (from->empty())
+        if constexpr (std::same_as<To, nullptr_t>)
             return nullptr;
 
-        auto const *o =
-            dynamic_cast<value_instance<To> const *>(from->object.get());
-
-        return o ? &o->object : nullptr;
+        auto const *p = detail::value_probe<To>(from);
+        if (!p)
+            SK_VALUE_COUNT(failed_casts, from->object.get());
+        return p;
     }
 
     template <value_containable To>
     auto value_cast(value const &from) -> To const & {
-        auto const &o = dynamic_cast<value_instance<To> const &>(*from.object);
-        return o.object;
+        if constexpr (std::same_as<To, nullptr_t>) {
+            if (typeid(*from.object) != typeid(value_instance<To>))
+                throw std::bad_cast();
+            return static_cast<value_instance<To> const &>(*from.object)
+                .object;
+        } else {
+            auto const *p = value_cast<To>(&from);
+            if (!p)
+                throw std::bad_cast();
+            return *p;
+        }
+    }
+
+    // If v holds a std::string, return a view of it without copying a
+    // borrowed string.
+    inline auto value_string_view(value const &v)
+        -> std::optional<std::string_view> {
+        auto const &t = typeid(*v.object);
+        if (t == typeid(value_instance<std::string>))
+            return static_cast<value_instance<std::string> const &>(*v.object)
+                .object;
+        if (t == typeid(value_borrowed_string))
+            return static_cast<value_borrowed_string const &>(*v.object).view;
+        return std::nullopt;
     }
 
     inline auto operator==(value const &a, value const &b) -> bool {
+        SK_VALUE_COUNT(comparisons, a.object.get());
         if (a.empty() or b.empty()) {
             if (a.empty() and b.empty())
                 return true;
@@ -252,10 +782,17 @@ namespace sk {
 
     template <value_containable T>
     inline auto operator==(value const &a, T const &b) -> bool {
-        auto const *p = value_cast<T>(&a);
-        if (!p)
-            return false;
-        return *p == b;
+        if constexpr (std::same_as<T, std::string>) {
+            SK_VALUE_COUNT(comparisons, a.object.get());
+            auto s = value_string_view(a);
+            return s && *s == b;
+        } else {
+            SK_VALUE_COUNT(comparisons, a.object.get());
+            auto const *p = detail::value_probe<T>(&a);
+            if (!p)
+                return false;
+            return *p == b;
+        }
     }
 
     template <value_containable T>
@@ -272,7 +809,9 @@ namespace sk {
     }
 
     inline auto operator==(value const &a, char const *b) -> bool {
-        return a == std::string(b);
+        SK_VALUE_COUNT(comparisons, a.object.get());
+        auto s = value_string_view(a);
+        return s && *s == b;
     }
 
     inline auto operator==(value const &a, wchar_t const *b) -> bool {
@@ -296,6 +835,7 @@ namespace sk {
     }
 
     inline auto operator<(value const &a, value const &b) -> bool {
+        SK_VALUE_COUNT(comparisons, a.object.get());
         if (a.empty()) {
             if (b.empty())
                 return false;
@@ -305,7 +845,7 @@ namespace sk {
         if (b.empty())
             return false;
 
-        auto const &ai = typeid(*a.object), &bi = typeid(*b.object);
+        auto const &ai = a.object->type(), &bi = b.object->type();
         if (ai != bi)
             return ai.before(bi);
         return a.object->lt(b.object.get());
@@ -319,6 +859,57 @@ namespace sk {
         return strm;
     }
 
+    /*
+     * Memory accounting.  value_memory_usage() is the memory a value
+     * occupies, including its own sizeof(value), its stored object and any
+     * memory the object owns (for example a std::string's buffer).  For a
+     * container of values it is the total for every element plus any unused
+     * capacity the container has allocated.
+     */
+    // The memory owned by a value outside of sizeof(value), so that types
+    // holding values can be accounted for the same way as strings.
+    inline auto value_heap_usage(value const &v) -> std::size_t {
+        return v.object ? v.object->memory_usage() : 0;
+    }
+
+    inline auto value_memory_usage(value const &v) -> std::size_t {
+        return sizeof(value) + value_heap_usage(v);
+    }
+
+    namespace detail {
+
+        // Elements of a container of values: values themselves, or the
+        // entries of a map keyed on values.
+        template <typename T>
+        auto value_element_heap_usage(T const &e) -> std::size_t {
+            if constexpr (std::same_as<T, value>)
+                return value_heap_usage(e);
+            else
+                return value_heap_usage(e.first) +
+                       value_heap_usage_of(e.second);
+        }
+
+    } // namespace detail
+
+    // clang-format off
+    template <std::ranges::input_range R>
+    auto value_memory_usage(R const &values) -> std::size_t
+        requires std::same_as<std::ranges::range_value_t<R>, value>
+              or std::same_as<
+                     std::remove_cv_t<typename std::ranges::range_value_t<R>::first_type>,
+                     value>
+    {
+        // clang-format on
+        std::size_t n = 0;
+        for (auto const &e : values)
+            n += sizeof(e) + detail::value_element_heap_usage(e);
+
+        if constexpr (requires { values.capacity() - values.size(); })
+            n += (values.capacity() - values.size()) *
+                 sizeof(std::ranges::range_value_t<R>);
+        return n;
+    }
+
 } // namespace sk
 
 /*
@@ -326,8 +917,44 @@ namespace sk {
  */
 template <> struct std::hash<sk::value> {
     std::size_t operator()(sk::value const &v) const {
+        SK_VALUE_COUNT(hashes, v.object.get());
         return v.object->hash();
     }
 };
 
+/*
+ * The stored types which the sk-value-core library compiles once, instead
+ * of every translation unit compiling its own copy of their instances.
+ */
+#define SK_VALUE_CORE_TYPES(X)                                                 \
+    X(std::nullptr_t)                                                          \
+    X(bool)                                                                    \
+    X(char)                                                                    \
+    X(signed char)                                                             \
+    X(unsigned char)                                                           \
+    X(short)                                                                   \
+    X(unsigned short)                                                          \
+    X(int)                                                                     \
+    X(unsigned int)                                                            \
+    X(long)                                                                    \
+    X(unsigned long)                                                           \
+    X(long long)                                                               \
+    X(unsigned long long)                                                      \
+    X(float)                                                                   \
+    X(double)                                                                  \
+    X(long double)                                                             \
+    X(std::string)                                                             \
+    X(std::wstring)                                                            \
+    X(std::u8string)                                                           \
+    X(std::u16string)                                                          \
+    X(std::u32string)
+
+#ifdef SK_VALUE_CORE
+namespace sk {
+#    define SK_VALUE_EXTERN_INSTANCE(T) extern template struct value_instance<T>;
+    SK_VALUE_CORE_TYPES(SK_VALUE_EXTERN_INSTANCE)
+#    undef SK_VALUE_EXTERN_INSTANCE
+} // namespace sk
+#endif
+
 #endif // SK_VALUE_HXX_INCLUDED
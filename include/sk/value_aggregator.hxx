@@ -0,0 +1,463 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef SK_VALUE_AGGREGATOR_HXX_INCLUDED
+#define SK_VALUE_AGGREGATOR_HXX_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "sk/value.hxx"
+#include "sk/value_hash.hxx"
+
+/*
+ * value_aggregator - group rows by value keys and aggregate them.
+ *
+ * A value_aggregator is created with the number of key columns and a list
+ * of aggregates, and is given batches of rows as columns: one column per
+ * key, and one input column per aggregate.  Rows with equal keys form a
+ * group, and each aggregate is computed over its input column for each
+ * group:
+ *
+ *   count - the number of non-empty inputs, as a std::int64_t.  A count
+ *           whose input column is an empty span counts rows instead.
+ *   sum   - the sum of the inputs, as a std::int64_t if they were all
+ *           integers and a double otherwise.  Integers are summed exactly
+ *           until the total would overflow std::int64_t; inputs which
+ *           would overflow it (including unsigned values above INT64_MAX)
+ *           are added as doubles instead, and the sum becomes a double.
+ *   min, max - the least or greatest input, ordered as sk::value orders.
+ *   avg   - the mean of the inputs, as a double.
+ *
+ * Empty inputs are ignored, and an aggregate with no inputs in a group is
+ * empty (except count, which is 0).  sum and avg throw
+ * std::invalid_argument for inputs which are not numbers; the inputs are
+ * checked before any row is added, so a batch which throws leaves the
+ * aggregator unchanged.
+ *
+ * Groups are kept in an open-addressing table which stores each group's
+ * hash and keys once.  A batch's keys are hashed with hash_values() and
+ * probed against the table without copying them, so only the first row
+ * of each group copies its keys.  Each input column is then checked for a
+ * single numeric type, which is accumulated without examining each
+ * value's type again.
+ *
+ * A value_aggregator is not thread-safe, but partial aggregates built
+ * separately (for example on different threads) can be combined with
+ * merge().
+ */
+
+namespace sk {
+
+    enum struct value_aggregate { count, sum, min, max, avg };
+
+    namespace detail {
+
+        // The running state of one aggregate for one group.
+        struct value_accumulator {
+            std::uint64_t count = 0;
+            std::int64_t int_sum = 0;
+            double double_sum = 0;
+            bool has_double = false;
+            std::optional<value> min, max;
+
+            template <typename T> void add_number(T const &x) {
+                ++count;
+                if constexpr (std::is_integral_v<T>)
+                    add_integer(x);
+                else {
+                    double_sum += static_cast<double>(x);
+                    has_double = true;
+                }
+            }
+
+            // Add to int_sum, or to double_sum if int_sum would overflow.
+            template <typename T> void add_integer(T x) {
+                using limits = std::numeric_limits<std::int64_t>;
+                if (std::in_range<std::int64_t>(x)) {
+                    auto y = static_cast<std::int64_t>(x);
+                    if (y < 0 ? int_sum >= limits::min() - y
+                              : int_sum <= limits::max() - y) {
+                        int_sum += y;
+                        return;
+                    }
+                }
+                double_sum += static_cast<double>(x);
+                has_double = true;
+            }
+
+            // Replace m with cell if cell orders before it (or after it,
+            // for the maximum); x is cell's object, of type T.
+            template <typename T>
+            static void update(std::optional<value> &m, value const &cell,
+                               T const &x, bool is_max) {
+                if (!m) {
+                    m = cell;
+                    return;
+                }
+                bool better;
+                if (auto const *p = detail::value_probe<T>(&*m))
+                    better = is_max ? value_lt_compare(*p, x)
+                                    : value_lt_compare(x, *p);
+                else
+                    better = is_max ? *m < cell : cell < *m;
+                if (better)
+                    *m = cell;
+            }
+
+            void merge(value_accumulator const &o) {
+                count += o.count;
+                add_integer(o.int_sum);
+                double_sum += o.double_sum;
+                has_double = has_double || o.has_double;
+                if (o.min && (!min || *o.min < *min))
+                    min = o.min;
+                if (o.max && (!max || *max < *o.max))
+                    max = o.max;
+            }
+
+            auto sum() const -> double {
+                return static_cast<double>(int_sum) + double_sum;
+            }
+        };
+
+        // Call f(T{}) if tag is the type tag of one of Ts.
+        template <typename... Ts> struct value_aggregate_types {
+            template <typename F>
+            static auto visit(void const *tag, F &&f) -> bool {
+                return ((tag == &value_type_tag<Ts> && (f(Ts{}), true)) ||
+                        ...);
+            }
+        };
+
+        using value_aggregate_numbers =
+            value_aggregate_types<int, long, long long, double, float, short,
+                                  signed char, unsigned, unsigned long,
+                                  unsigned long long, unsigned short,
+                                  unsigned char>;
+
+        inline auto value_aggregate_mix(std::uint64_t h) -> std::uint64_t {
+            h *= 0x9E3779B97F4A7C15ull;
+            return h ^ (h >> 32);
+        }
+
+    } // namespace detail
+
+    class value_aggregator {
+    public:
+        value_aggregator(std::size_t key_count,
+                         std::vector<value_aggregate> aggregates)
+            : key_count(key_count), aggregates(std::move(aggregates)) {
+            if (key_count == 0)
+                throw std::invalid_argument(
+                    "value_aggregator: at least one key is required");
+        }
+
+        // Add a batch of rows: keys[k][i] is key k of row i, and
+        // inputs[a][i] is the input to aggregate a for row i.
+        void add(std::span<std::span<value const> const> keys,
+                 std::span<std::span<value const> const> inputs) {
+            if (keys.size() != key_count || inputs.size() != aggregates.size())
+                throw std::invalid_argument(
+                    "value_aggregator: wrong number of columns");
+
+            auto rows = keys[0].size();
+            for (auto const &column : keys)
+                if (column.size() != rows)
+                    throw std::invalid_argument(
+                        "value_aggregator: columns differ in length");
+            for (std::size_t a = 0; a < inputs.size(); ++a)
+                if (inputs[a].size() != rows &&
+                    !(aggregates[a] == value_aggregate::count &&
+                      inputs[a].empty()))
+                    throw std::invalid_argument(
+                        "value_aggregator: columns differ in length");
+            for (std::size_t a = 0; a < inputs.size(); ++a)
+                if (aggregates[a] == value_aggregate::sum ||
+                    aggregates[a] == value_aggregate::avg)
+                    check_numbers(inputs[a]);
+
+            // Hash the keys a column at a time.
+            std::vector<std::uint64_t> hashes(rows), column_hashes(rows);
+            for (auto const &column : keys) {
+                hash_values(column, column_hashes);
+                for (std::size_t i = 0; i < rows; ++i)
+                    hashes[i] = detail::value_aggregate_mix(hashes[i] ^
+                                                            column_hashes[i]);
+            }
+
+            std::vector<std::uint32_t> row_groups(rows);
+            for (std::size_t i = 0; i < rows; ++i)
+                row_groups[i] = find_or_insert(
+                    hashes[i],
+                    [&](std::size_t k) -> value const & { return keys[k][i]; });
+
+            for (std::size_t a = 0; a < inputs.size(); ++a)
+                accumulate(a, inputs[a], row_groups);
+        }
+
+        // Add the groups of another aggregator with the same keys and
+        // aggregates to this one.
+        void merge(value_aggregator const &other) {
+            if (other.key_count != key_count ||
+                other.aggregates != aggregates)
+                throw std::invalid_argument(
+                    "value_aggregator: cannot merge different aggregations");
+
+            for (std::size_t g = 0; g < other.size(); ++g) {
+                auto group = find_or_insert(
+                    other.hashes[g], [&](std::size_t k) -> value const & {
+                        return other.group_keys[g * key_count + k];
+                    });
+                for (std::size_t a = 0; a < aggregates.size(); ++a)
+                    state(group, a).merge(other.state(g, a));
+            }
+        }
+
+        // The number of groups.
+        auto size() const -> std::size_t {
+            return hashes.size();
+        }
+
+        // The keys of a group, in the order of the key columns.
+        auto key(std::size_t group) const -> std::span<value const> {
+            return std::span<value const>(group_keys)
+                .subspan(group * key_count, key_count);
+        }
+
+        // The result of an aggregate for a group.
+        auto result(std::size_t group, std::size_t aggregate) const -> value {
+            auto const &s = state(group, aggregate);
+            switch (aggregates[aggregate]) {
+            case value_aggregate::count:
+                return value(static_cast<std::int64_t>(s.count));
+            case value_aggregate::sum:
+                if (s.count == 0)
+                    return value();
+                if (s.has_double)
+                    return value(s.sum());
+                return value(s.int_sum);
+            case value_aggregate::min:
+                return s.min ? *s.min : value();
+            case value_aggregate::max:
+                return s.max ? *s.max : value();
+            case value_aggregate::avg:
+                if (s.count == 0)
+                    return value();
+                return value(s.sum() / static_cast<double>(s.count));
+            }
+            return value();
+        }
+
+    private:
+        std::size_t key_count;
+        std::vector<value_aggregate> aggregates;
+
+        // Per group: its hash, key_count keys and an accumulator for each
+        // aggregate.
+        std::vector<std::uint64_t> hashes;
+        std::vector<value> group_keys;
+        std::vector<detail::value_accumulator> states;
+
+        // Open-addressing index: group + 1, or 0 for an empty slot.
+        std::vector<std::uint32_t> slots;
+
+        auto state(std::size_t group, std::size_t a)
+            -> detail::value_accumulator & {
+            return states[group * aggregates.size() + a];
+        }
+
+        auto state(std::size_t group, std::size_t a) const
+            -> detail::value_accumulator const & {
+            return states[group * aggregates.size() + a];
+        }
+
+        // Find the group with this hash and keys, adding it if there is
+        // none; key(k) returns key k.
+        template <typename Key>
+        auto find_or_insert(std::uint64_t hash, Key &&key) -> std::uint32_t {
+            if ((size() + 1) * 8 > slots.size() * 7)
+                grow();
+
+            auto mask = slots.size() - 1;
+            for (auto i = hash & mask;; i = (i + 1) & mask) {
+                auto slot = slots[i];
+                if (slot == 0) {
+                    auto group = static_cast<std::uint32_t>(size());
+                    slots[i] = group + 1;
+                    hashes.push_back(hash);
+                    for (std::size_t k = 0; k < key_count; ++k)
+                        group_keys.push_back(key(k));
+                    states.resize(states.size() + aggregates.size());
+                    return group;
+                }
+
+                auto group = slot - 1;
+                if (hashes[group] == hash && keys_equal(group, key))
+                    return group;
+            }
+        }
+
+        template <typename Key>
+        auto keys_equal(std::size_t group, Key &&key) const -> bool {
+            for (std::size_t k = 0; k < key_count; ++k)
+                if (!(group_keys[group * key_count + k] == key(k)))
+                    return false;
+            return true;
+        }
+
+        // Double the index, placing groups by their stored hashes.
+        void grow() {
+            std::vector<std::uint32_t> bigger(
+                slots.empty() ? 16 : slots.size() * 2);
+            auto mask = bigger.size() - 1;
+            for (std::size_t g = 0; g < size(); ++g) {
+                auto i = hashes[g] & mask;
+                while (bigger[i] != 0)
+                    i = (i + 1) & mask;
+                bigger[i] = static_cast<std::uint32_t>(g + 1);
+            }
+            slots = std::move(bigger);
+        }
+
+        void accumulate(std::size_t a, std::span<value const> input,
+                        std::span<std::uint32_t const> row_groups) {
+            auto kind = aggregates[a];
+
+            if (input.empty()) { // count(*)
+                for (auto group : row_groups)
+                    ++state(group, a).count;
+                return;
+            }
+
+            // If every input has the same numeric type, accumulate it
+            // without examining each value's type.
+            auto const *tag = input[0].object->type_tag();
+            bool same_type = true;
+            for (auto const &v : input)
+                if (v.object->type_tag() != tag) {
+                    same_type = false;
+                    break;
+                }
+
+            if (same_type &&
+                detail::value_aggregate_numbers::visit(tag, [&](auto t) {
+                    using T = decltype(t);
+                    for (std::size_t i = 0; i < input.size(); ++i)
+                        add_typed<T>(state(row_groups[i], a), kind, input[i],
+                                     *value_cast<T>(&input[i]));
+                }))
+                return;
+
+            for (std::size_t i = 0; i < input.size(); ++i)
+                add_one(state(row_groups[i], a), kind, input[i]);
+        }
+
+        template <typename T>
+        static void add_typed(detail::value_accumulator &s,
+                              value_aggregate kind, value const &cell,
+                              T const &x) {
+            switch (kind) {
+            case value_aggregate::count:
+                ++s.count;
+                break;
+            case value_aggregate::sum:
+            case value_aggregate::avg:
+                s.add_number(x);
+                break;
+            case value_aggregate::min:
+                ++s.count;
+                detail::value_accumulator::update(s.min, cell, x, false);
+                break;
+            case value_aggregate::max:
+                ++s.count;
+                detail::value_accumulator::update(s.max, cell, x, true);
+                break;
+            }
+        }
+
+        // Throw unless every value is a number or empty.
+        static void check_numbers(std::span<value const> input) {
+            void const *checked = nullptr;
+            for (auto const &v : input) {
+                auto const *tag = v.object->type_tag();
+                if (tag == checked || tag == &value_type_tag<nullptr_t>)
+                    continue;
+                if (!detail::value_aggregate_numbers::visit(tag, [](auto) {}))
+                    throw std::invalid_argument(
+                        "value_aggregator: cannot sum a non-numeric value");
+                checked = tag;
+            }
+        }
+
+        // Accumulate one value of any type.
+        static void add_one(detail::value_accumulator &s,
+                            value_aggregate kind, value const &cell) {
+            auto const *tag = cell.object->type_tag();
+            if (tag == &value_type_tag<nullptr_t>)
+                return;
+
+            if (detail::value_aggregate_numbers::visit(tag, [&](auto t) {
+                    using T = decltype(t);
+                    add_typed<T>(s, kind, cell, *value_cast<T>(&cell));
+                }))
+                return;
+
+            switch (kind) {
+            case value_aggregate::count:
+                ++s.count;
+                break;
+            case value_aggregate::sum:
+            case value_aggregate::avg:
+                throw std::invalid_argument(
+                    "value_aggregator: cannot sum a non-numeric value");
+            case value_aggregate::min:
+                ++s.count;
+                if (!s.min || cell < *s.min)
+                    s.min = cell;
+                break;
+            case value_aggregate::max:
+                ++s.count;
+                if (!s.max || *s.max < cell)
+                    s.max = cell;
+                break;
+            }
+        }
+    };
+
+} // namespace sk
+
+#endif // SK_VALUE_AGGREGATOR_HXX_INCLUDED
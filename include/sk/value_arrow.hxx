@@ -0,0 +1,471 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef SK_VALUE_ARROW_HXX_INCLUDED
+#define SK_VALUE_ARROW_HXX_INCLUDED
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <typeinfo>
+#include <vector>
+
+#include "sk/value.hxx"
+#include "sk/value_wire.hxx"
+
+/*
+ * The Apache Arrow C data interface structures, as defined by the Arrow
+ * specification.  The guard macro is the one used by Arrow itself, so this
+ * can be included together with the Arrow headers.
+ */
+#ifndef ARROW_C_DATA_INTERFACE
+#    define ARROW_C_DATA_INTERFACE
+
+#    define ARROW_FLAG_DICTIONARY_ORDERED 1
+#    define ARROW_FLAG_NULLABLE 2
+#    define ARROW_FLAG_MAP_KEYS_SORTED 4
+
+extern "C" {
+
+struct ArrowSchema {
+    // Array type description
+    const char *format;
+    const char *name;
+    const char *metadata;
+    int64_t flags;
+    int64_t n_children;
+    struct ArrowSchema **children;
+    struct ArrowSchema *dictionary;
+
+    // Release callback
+    void (*release)(struct ArrowSchema *);
+    // Opaque producer-specific data
+    void *private_data;
+};
+
+struct ArrowArray {
+    // Array data description
+    int64_t length;
+    int64_t null_count;
+    int64_t offset;
+    int64_t n_buffers;
+    int64_t n_children;
+    const void **buffers;
+    struct ArrowArray **children;
+    struct ArrowArray *dictionary;
+
+    // Release callback
+    void (*release)(struct ArrowArray *);
+    // Opaque producer-specific data
+    void *private_data;
+};
+
+} // extern "C"
+
+#endif // ARROW_C_DATA_INTERFACE
+
+/*
+ * export_arrow, import_arrow - exchange columns of values with Arrow through
+ * the C data interface, without depending on the Arrow libraries.
+ *
+ * export_arrow() converts a column whose values all have the same type into
+ * an Arrow array: bool as a boolean bitmap, integers as the Arrow integer
+ * type of the same width and signedness, float and double as float32 and
+ * float64, and strings as utf8 (or large_utf8 if the data exceeds 2 GiB).
+ * Empty values become nulls, and a column holding only empty values becomes
+ * an Arrow null array.  Each buffer is filled with a single allocation and
+ * is owned by the exported array until Arrow calls its release callback.
+ * Any other type, or a column mixing types, throws std::invalid_argument.
+ *
+ * import_arrow() appends the cells of an Arrow array of one of those types,
+ * or of binary or large_binary, to a vector of values.  Integers keep their
+ * Arrow width (int32 becomes std::int32_t, and so on), nulls become empty
+ * values, and the array offset is honoured.  The caller keeps ownership of
+ * the array.  With value_wire_strings::borrow, strings are returned as
+ * borrowed values (see value::borrow()) pointing into the array's data
+ * buffer, so the array must not be released while they are in use.
+ * Dictionary-encoded and nested arrays throw value_format_error.
+ */
+
+namespace sk {
+
+    namespace detail {
+
+        // The Arrow format string for a built-in type.
+        template <typename T>
+        constexpr auto value_arrow_format() -> char const * {
+            if constexpr (std::same_as<T, bool>)
+                return "b";
+            else if constexpr (std::same_as<T, float>)
+                return "f";
+            else if constexpr (std::same_as<T, double>)
+                return "g";
+            else if constexpr (std::same_as<T, std::string>)
+                return "u";
+            else {
+                constexpr bool s = std::is_signed_v<T>;
+                switch (sizeof(T)) {
+                case 1:
+                    return s ? "c" : "C";
+                case 2:
+                    return s ? "s" : "S";
+                case 4:
+                    return s ? "i" : "I";
+                default:
+                    return s ? "l" : "L";
+                }
+            }
+        }
+
+        // Buffers owned by an exported ArrowArray.
+        struct value_arrow_array_data {
+            std::vector<std::byte> validity, offsets, data;
+            void const *buffers[3] = {};
+        };
+
+        // Storage owned by an exported ArrowSchema.
+        struct value_arrow_schema_data {
+            std::string name;
+        };
+
+        inline void value_arrow_release_array(ArrowArray *array) {
+            delete static_cast<value_arrow_array_data *>(array->private_data);
+            array->release = nullptr;
+        }
+
+        inline void value_arrow_release_schema(ArrowSchema *schema) {
+            delete static_cast<value_arrow_schema_data *>(schema->private_data);
+            schema->release = nullptr;
+        }
+
+        inline void value_arrow_set_bit(std::vector<std::byte> &bits,
+                                        std::size_t i) {
+            bits[i / 8] |= static_cast<std::byte>(1u << (i % 8));
+        }
+
+        inline auto value_arrow_get_bit(void const *bits, std::int64_t i)
+            -> bool {
+            auto const *p = static_cast<unsigned char const *>(bits);
+            return (p[i / 8] >> (i % 8)) & 1;
+        }
+
+        template <typename Offset>
+        void value_arrow_fill_strings(std::span<value const> column,
+                                      value_arrow_array_data &d,
+                                      std::size_t total) {
+            d.offsets.resize((column.size() + 1) * sizeof(Offset));
+            d.data.resize(total);
+
+            Offset offset = 0;
+            std::memcpy(d.offsets.data(), &offset, sizeof(Offset));
+            for (std::size_t i = 0; i < column.size(); ++i) {
+                if (auto s = value_string_view(column[i])) {
+                    if (!s->empty())
+                        std::memcpy(d.data.data() + offset, s->data(),
+                                    s->size());
+                    offset += static_cast<Offset>(s->size());
+                }
+                std::memcpy(d.offsets.data() + (i + 1) * sizeof(Offset),
+                            &offset, sizeof(Offset));
+            }
+        }
+
+        // Fill the data buffers for a column of T; returns the format.
+        template <typename T>
+        auto value_arrow_fill(std::span<value const> column,
+                              value_arrow_array_data &d) -> char const * {
+            auto n = column.size();
+
+            if constexpr (std::same_as<T, std::string>) {
+                std::size_t total = 0;
+                for (auto const &v : column)
+                    if (auto s = value_string_view(v))
+                        total += s->size();
+
+                if (total <= static_cast<std::size_t>(
+                                 std::numeric_limits<std::int32_t>::max())) {
+                    value_arrow_fill_strings<std::int32_t>(column, d, total);
+                    return "u";
+                }
+                value_arrow_fill_strings<std::int64_t>(column, d, total);
+                return "U";
+            } else if constexpr (std::same_as<T, bool>) {
+                d.data.resize((n + 7) / 8);
+                for (std::size_t i = 0; i < n; ++i)
+                    if (!column[i].empty() && value_cast<bool>(column[i]))
+                        value_arrow_set_bit(d.data, i);
+            } else {
+                d.data.resize(n * sizeof(T));
+                auto *p = d.data.data();
+                for (std::size_t i = 0; i < n; ++i, p += sizeof(T))
+                    if (!column[i].empty())
+                        std::memcpy(p, &value_cast<T>(column[i]), sizeof(T));
+            }
+            return value_arrow_format<T>();
+        }
+
+        template <typename... Ts>
+        auto value_arrow_fill_as(std::type_info const &type,
+                                 std::span<value const> column,
+                                 value_arrow_array_data &d) -> char const * {
+            char const *format = nullptr;
+            ((type == typeid(value_instance<Ts>) &&
+              (format = value_arrow_fill<Ts>(column, d))) ||
+             ...);
+            return format;
+        }
+
+        template <typename T>
+        void value_arrow_import_fixed(ArrowArray const &array,
+                                      std::vector<value> &out) {
+            auto const *data = static_cast<std::byte const *>(array.buffers[1]);
+            auto const *validity = array.buffers[0];
+
+            for (std::int64_t i = array.offset; i < array.offset + array.length;
+                 ++i) {
+                if (validity && !value_arrow_get_bit(validity, i)) {
+                    out.emplace_back();
+                } else if constexpr (std::same_as<T, bool>) {
+                    out.emplace_back(value_arrow_get_bit(data, i));
+                } else {
+                    T t;
+                    std::memcpy(&t, data + i * sizeof(T), sizeof(T));
+                    out.emplace_back(t);
+                }
+            }
+        }
+
+        template <typename Offset>
+        void value_arrow_import_strings(ArrowArray const &array,
+                                        std::vector<value> &out,
+                                        value_wire_strings strings) {
+            auto const *offsets =
+                static_cast<std::byte const *>(array.buffers[1]);
+            auto const *data = static_cast<char const *>(array.buffers[2]);
+            auto const *validity = array.buffers[0];
+
+            auto offset_at = [&](std::int64_t i) {
+                Offset o;
+                std::memcpy(&o, offsets + i * sizeof(Offset), sizeof(Offset));
+                return o;
+            };
+
+            for (std::int64_t i = array.offset; i < array.offset + array.length;
+                 ++i) {
+                if (validity && !value_arrow_get_bit(validity, i)) {
+                    out.emplace_back();
+                    continue;
+                }
+
+                auto begin = offset_at(i), end = offset_at(i + 1);
+                if (begin < 0 || end < begin)
+                    throw value_format_error("sk::import_arrow: bad offsets");
+
+                std::string_view s(data + begin,
+                                   static_cast<std::size_t>(end - begin));
+                if (strings == value_wire_strings::borrow)
+                    out.push_back(value::borrow(s));
+                else
+                    out.emplace_back(std::string(s));
+            }
+        }
+
+    } // namespace detail
+
+    /*
+     * Export a column to Arrow.  On success, array and schema are owned by
+     * the caller, who must eventually call their release callbacks.
+     */
+    inline void export_arrow(std::span<value const> column, ArrowArray *array,
+                             ArrowSchema *schema,
+                             std::string_view name = {}) {
+        using namespace detail;
+
+        std::type_info const *type = nullptr;
+        std::int64_t null_count = 0;
+        for (auto const &v : column) {
+            if (v.empty()) {
+                ++null_count;
+                continue;
+            }
+
+            auto const &t = v.object->type();
+            if (!type)
+                type = &t;
+            else if (*type != t)
+                throw std::invalid_argument(
+                    "sk::export_arrow: column has mixed types");
+        }
+
+        auto d = std::make_unique<value_arrow_array_data>();
+        auto const *format = "n";
+        std::int64_t n_buffers = 0;
+
+        if (type) {
+            format = value_arrow_fill_as<
+                bool, signed char, unsigned char, short, unsigned short, int,
+                unsigned int, long, unsigned long, long long,
+                unsigned long long, float, double, std::string>(*type, column,
+                                                                *d);
+            if (!format)
+                throw std::invalid_argument(
+                    "sk::export_arrow: unsupported type");
+
+            // Consumers may require non-null data buffers even when empty.
+            if (d->data.empty())
+                d->data.resize(1);
+
+            if (null_count) {
+                d->validity.resize((column.size() + 7) / 8);
+                for (std::size_t i = 0; i < column.size(); ++i)
+                    if (!column[i].empty())
+                        value_arrow_set_bit(d->validity, i);
+            }
+
+            d->buffers[0] = null_count ? d->validity.data() : nullptr;
+            if (d->offsets.empty()) {
+                d->buffers[1] = d->data.data();
+                n_buffers = 2;
+            } else {
+                d->buffers[1] = d->offsets.data();
+                d->buffers[2] = d->data.data();
+                n_buffers = 3;
+            }
+        }
+
+        auto s = std::make_unique<value_arrow_schema_data>();
+        s->name = name;
+
+        *array = ArrowArray{};
+        array->length = static_cast<std::int64_t>(column.size());
+        array->null_count = null_count;
+        array->n_buffers = n_buffers;
+        array->buffers = d->buffers;
+        array->release = value_arrow_release_array;
+        array->private_data = d.release();
+
+        *schema = ArrowSchema{};
+        schema->format = format;
+        schema->name = s->name.c_str();
+        schema->flags = ARROW_FLAG_NULLABLE;
+        schema->release = value_arrow_release_schema;
+        schema->private_data = s.release();
+    }
+
+    /*
+     * Append the cells of an Arrow array to out.
+     */
+    inline void
+    import_arrow(ArrowArray const &array, ArrowSchema const &schema,
+                 std::vector<value> &out,
+                 value_wire_strings strings = value_wire_strings::copy) {
+        using namespace detail;
+
+        if (!array.release || !schema.release)
+            throw value_format_error("sk::import_arrow: array was released");
+        if (schema.dictionary || array.dictionary)
+            throw value_format_error(
+                "sk::import_arrow: dictionary arrays are not supported");
+        if (array.length < 0 || array.offset < 0)
+            throw value_format_error("sk::import_arrow: bad length");
+
+        std::string_view format(schema.format ? schema.format : "");
+        if (format.size() != 1)
+            throw value_format_error("sk::import_arrow: unsupported format");
+
+        auto expect_buffers = [&](std::int64_t n) {
+            if (array.n_buffers != n ||
+                (array.length && ((n > 1 && !array.buffers[1]) ||
+                                  (n > 2 && !array.buffers[2]))))
+                throw value_format_error("sk::import_arrow: missing buffers");
+        };
+
+        out.reserve(out.size() + static_cast<std::size_t>(array.length));
+
+        switch (format[0]) {
+        case 'n':
+            out.resize(out.size() + static_cast<std::size_t>(array.length));
+            return;
+        case 'b':
+            expect_buffers(2);
+            return value_arrow_import_fixed<bool>(array, out);
+        case 'c':
+            expect_buffers(2);
+            return value_arrow_import_fixed<std::int8_t>(array, out);
+        case 'C':
+            expect_buffers(2);
+            return value_arrow_import_fixed<std::uint8_t>(array, out);
+        case 's':
+            expect_buffers(2);
+            return value_arrow_import_fixed<std::int16_t>(array, out);
+        case 'S':
+            expect_buffers(2);
+            return value_arrow_import_fixed<std::uint16_t>(array, out);
+        case 'i':
+            expect_buffers(2);
+            return value_arrow_import_fixed<std::int32_t>(array, out);
+        case 'I':
+            expect_buffers(2);
+            return value_arrow_import_fixed<std::uint32_t>(array, out);
+        case 'l':
+            expect_buffers(2);
+            return value_arrow_import_fixed<std::int64_t>(array, out);
+        case 'L':
+            expect_buffers(2);
+            return value_arrow_import_fixed<std::uint64_t>(array, out);
+        case 'f':
+            expect_buffers(2);
+            return value_arrow_import_fixed<float>(array, out);
+        case 'g':
+            expect_buffers(2);
+            return value_arrow_import_fixed<double>(array, out);
+        case 'u':
+        case 'z':
+            expect_buffers(3);
+            return value_arrow_import_strings<std::int32_t>(array, out,
+                                                            strings);
+        case 'U':
+        case 'Z':
+            expect_buffers(3);
+            return value_arrow_import_strings<std::int64_t>(array, out,
+                                                            strings);
+        default:
+            throw value_format_error("sk::import_arrow: unsupported format");
+        }
+    }
+
+} // namespace sk
+
+#endif // SK_VALUE_ARROW_HXX_INCLUDED
@@ -0,0 +1,658 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SK_VALUE_BINARY_HXX_INCLUDED
+#define SK_VALUE_BINARY_HXX_INCLUDED
+
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <typeindex>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#    include <io.h>
+#else
+#    include <unistd.h>
+#endif
+
+#include "sk/value.hxx"
+
+/*
+ * value_writer, value_reader - compact binary serialisation of values.
+ *
+ * A stream starts with the four bytes "SKV" followed by the format version.
+ * Each value is then written as a one-byte type tag followed by its payload:
+ *
+ *   0x00         empty value, no payload
+ *   0x01, 0x02   bool false and true, no payload
+ *   0x03         char, one byte
+ *   0x04..0x08   signed char, short, int, long, long long: zigzag varint
+ *   0x09..0x0D   the corresponding unsigned types: varint
+ *   0x0E, 0x0F   float and double: 4 or 8 bytes, little-endian IEEE
+ *   0x10         std::string: varint length, then the bytes
+ *   0x7E         batch: varint count, then that many values
+ *   0x7F         user type: varint type id, varint length, then the bytes
+ *
+ * Varints are little-endian base 128, as used by protocol buffers.  Integers
+ * are range-checked when read back, so a stream is portable between
+ * platforms with different integer sizes as long as the values fit.
+ *
+ * Other types can be written once they have been registered with
+ * register_value_type(), which gives the type a numeric id and functions to
+ * convert it to and from bytes.
+ */
+
+namespace sk {
+
+    namespace detail {
+
+        inline constexpr std::byte value_binary_magic[] = {
+            std::byte{'S'}, std::byte{'K'}, std::byte{'V'}, std::byte{1}};
+
+        enum value_binary_tag : unsigned char {
+            value_tag_empty = 0x00,
+            value_tag_false = 0x01,
+            value_tag_true = 0x02,
+            value_tag_char = 0x03,
+            value_tag_batch = 0x7E,
+            value_tag_user = 0x7F,
+        };
+
+        template <typename T> struct value_binary_type;
+
+        // clang-format off
+        template <> struct value_binary_type<char>               { static constexpr unsigned char tag = 0x03; };
+        template <> struct value_binary_type<signed char>        { static constexpr unsigned char tag = 0x04; };
+        template <> struct value_binary_type<short>              { static constexpr unsigned char tag = 0x05; };
+        template <> struct value_binary_type<int>                { static constexpr unsigned char tag = 0x06; };
+        template <> struct value_binary_type<long>               { static constexpr unsigned char tag = 0x07; };
+        template <> struct value_binary_type<long long>          { static constexpr unsigned char tag = 0x08; };
+        template <> struct value_binary_type<unsigned char>      { static constexpr unsigned char tag = 0x09; };
+        template <> struct value_binary_type<unsigned short>     { static constexpr unsigned char tag = 0x0A; };
+        template <> struct value_binary_type<unsigned int>       { static constexpr unsigned char tag = 0x0B; };
+        template <> struct value_binary_type<unsigned long>      { static constexpr unsigned char tag = 0x0C; };
+        template <> struct value_binary_type<unsigned long long> { static constexpr unsigned char tag = 0x0D; };
+        template <> struct value_binary_type<float>              { static constexpr unsigned char tag = 0x0E; };
+        template <> struct value_binary_type<double>             { static constexpr unsigned char tag = 0x0F; };
+        template <> struct value_binary_type<std::string>        { static constexpr unsigned char tag = 0x10; };
+        // clang-format on
+
+        inline auto value_zigzag(std::int64_t v) -> std::uint64_t {
+            return (static_cast<std::uint64_t>(v) << 1) ^
+                   static_cast<std::uint64_t>(v >> 63);
+        }
+
+        inline auto value_unzigzag(std::uint64_t u) -> std::int64_t {
+            return static_cast<std::int64_t>((u >> 1) ^ (~(u & 1) + 1));
+        }
+
+        // Decode a varint from memory, advancing p.
+        inline auto value_binary_varint(std::byte const *&p,
+                                        std::byte const *end)
+            -> std::uint64_t {
+            std::uint64_t u = 0;
+            for (int shift = 0; shift < 64 && p != end; shift += 7) {
+                auto b = static_cast<unsigned char>(*p++);
+                u |= static_cast<std::uint64_t>(b & 0x7F) << shift;
+                if (!(b & 0x80))
+                    return u;
+            }
+            throw value_format_error("sk::value: invalid varint");
+        }
+
+        inline void value_sys_write(int fd, std::byte const *p, std::size_t n) {
+            while (n) {
+#ifdef _WIN32
+                auto r = ::_write(fd, p, static_cast<unsigned>(n));
+#else
+                auto r = ::write(fd, p, n);
+#endif
+                if (r < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    throw std::system_error(errno, std::generic_category(),
+                                            "sk::value_writer");
+                }
+                p += r;
+                n -= static_cast<std::size_t>(r);
+            }
+        }
+
+        inline auto value_sys_read(int fd, std::byte *p, std::size_t n)
+            -> std::size_t {
+            for (;;) {
+#ifdef _WIN32
+                auto r = ::_read(fd, p, static_cast<unsigned>(n));
+#else
+                auto r = ::read(fd, p, n);
+#endif
+                if (r >= 0)
+                    return static_cast<std::size_t>(r);
+                if (errno != EINTR)
+                    throw std::system_error(errno, std::generic_category(),
+                                            "sk::value_reader");
+            }
+        }
+
+    } // namespace detail
+
+    /*
+     * The registry of user types which can be serialised.  Types are usually
+     * registered once at startup with register_value_type().
+     */
+    class value_type_registry {
+    public:
+        using encoder = std::function<void(value const &, std::string &)>;
+        using decoder = std::function<value(std::string_view)>;
+
+        struct entry {
+            std::uint32_t id;
+            // typeid(value_instance<T>) for the registered T.
+            std::type_info const *type;
+            encoder encode;
+            decoder decode;
+        };
+
+        static auto global() -> value_type_registry & {
+            static value_type_registry registry;
+            return registry;
+        }
+
+        template <value_containable T>
+        void add(std::uint32_t id,
+                 std::function<void(T const &, std::string &)> encode,
+                 std::function<T(std::string_view)> decode) {
+            auto e = std::make_shared<entry>(entry{
+                id, &typeid(value_instance<T>),
+                [encode](value const &v, std::string &out) {
+                    encode(value_cast<T>(v), out);
+                },
+                [decode](std::string_view bytes) {
+                    return value(decode(bytes));
+                }});
+
+            std::unique_lock lock(mutex);
+            if (by_id.contains(id))
+                throw std::invalid_argument(
+                    "sk::value_type_registry: duplicate type id");
+            by_type[std::type_index(typeid(value_instance<T>))] = e;
+            by_id[id] = std::move(e);
+        }
+
+        auto find(std::type_info const &instance_type) const
+            -> std::shared_ptr<entry const> {
+            std::shared_lock lock(mutex);
+            auto it = by_type.find(std::type_index(instance_type));
+            return it == by_type.end() ? nullptr : it->second;
+        }
+
+        auto find(std::uint32_t id) const -> std::shared_ptr<entry const> {
+            std::shared_lock lock(mutex);
+            auto it = by_id.find(id);
+            return it == by_id.end() ? nullptr : it->second;
+        }
+
+    private:
+        mutable std::shared_mutex mutex;
+        std::map<std::type_index, std::shared_ptr<entry const>> by_type;
+        std::map<std::uint32_t, std::shared_ptr<entry const>> by_id;
+    };
+
+    // Register a user type with the global registry.  The encoder appends
+    // the object's bytes to the string; the decoder reconstructs the object.
+    template <value_containable T>
+    void register_value_type(
+        std::uint32_t id, std::function<void(T const &, std::string &)> encode,
+        std::function<T(std::string_view)> decode) {
+        value_type_registry::global().add<T>(id, std::move(encode),
+                                             std::move(decode));
+    }
+
+    /*
+     * Write values to a caller-supplied buffer, or to a file descriptor in
+     * chunks of chunk_size bytes.
+     */
+    class value_writer {
+    public:
+        // Write into a fixed buffer; throws value_format_error if the buffer
+        // is too small.
+        explicit value_writer(std::span<std::byte> buffer)
+            : begin(buffer.data()), cur(buffer.data()),
+              end(buffer.data() + buffer.size()) {
+            put(detail::value_binary_magic, sizeof(detail::value_binary_magic));
+        }
+
+        explicit value_writer(int fd, std::size_t chunk_size = 64 * 1024)
+            : fd(fd), chunk(chunk_size) {
+            begin = cur = chunk.data();
+            end = begin + chunk.size();
+            put(detail::value_binary_magic, sizeof(detail::value_binary_magic));
+        }
+
+        value_writer(value_writer const &) = delete;
+        auto operator=(value_writer const &) -> value_writer & = delete;
+
+        ~value_writer() {
+            try {
+                flush();
+            } catch (...) {
+                // Call flush() explicitly to see write errors.
+            }
+        }
+
+        void write(value const &v) {
+            if (!(write_as<bool, char, signed char, short, int, long,
+                           long long, unsigned char, unsigned short,
+                           unsigned int, unsigned long, unsigned long long,
+                           float, double, std::string>(v)))
+                write_user(v);
+        }
+
+        void write_batch(std::span<value const> values) {
+            put_byte(detail::value_tag_batch);
+            put_varint(values.size());
+            for (auto const &v : values)
+                write(v);
+        }
+
+        // Write any buffered data to the file descriptor.
+        void flush() {
+            if (fd < 0)
+                return;
+            detail::value_sys_write(fd, begin,
+                                    static_cast<std::size_t>(cur - begin));
+            cur = begin;
+        }
+
+        // The bytes written so far, when writing to a buffer.
+        auto data() const -> std::span<std::byte const> {
+            return {begin, static_cast<std::size_t>(cur - begin)};
+        }
+
+    private:
+        int fd = -1;
+        std::vector<std::byte> chunk;
+        std::byte *begin, *cur, *end;
+        std::string scratch;
+
+        void overflow() {
+            if (fd < 0)
+                throw value_format_error("sk::value_writer: buffer full");
+            flush();
+        }
+
+        void put(void const *p, std::size_t n) {
+            auto const *src = static_cast<std::byte const *>(p);
+
+            // Large writes bypass the chunk buffer.
+            if (fd >= 0 && n > chunk.size()) {
+                flush();
+                detail::value_sys_write(fd, src, n);
+                return;
+            }
+
+            while (n) {
+                if (cur == end)
+                    overflow();
+                auto len = std::min(n, static_cast<std::size_t>(end - cur));
+                std::memcpy(cur, src, len);
+                cur += len;
+                src += len;
+                n -= len;
+            }
+        }
+
+        void put_byte(unsigned char b) {
+            if (cur == end)
+                overflow();
+            *cur++ = static_cast<std::byte>(b);
+        }
+
+        void put_varint(std::uint64_t u) {
+            unsigned char buf[10];
+            std::size_t n = 0;
+            do {
+                buf[n++] = static_cast<unsigned char>((u & 0x7F) |
+                                                      (u > 0x7F ? 0x80 : 0));
+                u >>= 7;
+            } while (u);
+            put(buf, n);
+        }
+
+        template <std::unsigned_integral U> void put_fixed(U u) {
+            unsigned char buf[sizeof(U)];
+            for (std::size_t i = 0; i < sizeof(U); ++i)
+                buf[i] = static_cast<unsigned char>(u >> (i * CHAR_BIT));
+            put(buf, sizeof(U));
+        }
+
+        template <typename T> auto write_one(value const &v) -> bool {
+            auto const *p = detail::value_probe<T>(&v);
+            if (!p)
+                return false;
+
+            if constexpr (std::same_as<T, bool>) {
+                put_byte(*p ? detail::value_tag_true : detail::value_tag_false);
+            } else {
+                put_byte(detail::value_binary_type<T>::tag);
+                if constexpr (std::same_as<T, char>)
+                    put_byte(static_cast<unsigned char>(*p));
+                else if constexpr (std::signed_integral<T>)
+                    put_varint(detail::value_zigzag(*p));
+                else if constexpr (std::unsigned_integral<T>)
+                    put_varint(*p);
+                else if constexpr (std::same_as<T, float>)
+                    put_fixed(std::bit_cast<std::uint32_t>(*p));
+                else if constexpr (std::same_as<T, double>)
+                    put_fixed(std::bit_cast<std::uint64_t>(*p));
+                else {
+                    put_varint(p->size());
+                    put(p->data(), p->size());
+                }
+            }
+            return true;
+        }
+
+        template <typename... Ts> auto write_as(value const &v) -> bool {
+            if (v.empty()) {
+                put_byte(detail::value_tag_empty);
+                return true;
+            }
+            return (write_one<Ts>(v) || ...);
+        }
+
+        void write_user(value const &v) {
+            auto e = value_type_registry::global().find(v.object->type());
+            if (!e)
+                throw value_format_error(
+                    "sk::value_writer: type is not registered");
+
+            scratch.clear();
+            e->encode(v, scratch);
+            put_byte(detail::value_tag_user);
+            put_varint(e->id);
+            put_varint(scratch.size());
+            put(scratch.data(), scratch.size());
+        }
+    };
+
+    /*
+     * Read values from a buffer, or from a file descriptor in chunks of
+     * chunk_size bytes.
+     */
+    class value_reader {
+    public:
+        explicit value_reader(std::span<std::byte const> buffer)
+            : cur(buffer.data()), end(buffer.data() + buffer.size()) {}
+
+        explicit value_reader(int fd, std::size_t chunk_size = 64 * 1024)
+            : fd(fd), chunk(chunk_size) {
+            cur = end = chunk.data();
+        }
+
+        value_reader(value_reader const &) = delete;
+        auto operator=(value_reader const &) -> value_reader & = delete;
+
+        // Read the next value.  Returns false at the end of the stream.
+        // A batch is returned as its individual values.
+        auto read(value &v) -> bool {
+            if (!start())
+                return false;
+
+            for (;;) {
+                if (cur == end && !fill(1)) {
+                    if (in_batch)
+                        throw value_format_error(
+                            "sk::value_reader: truncated batch");
+                    return false;
+                }
+
+                auto tag = get_byte();
+                if (tag == detail::value_tag_batch) {
+                    in_batch += get_varint();
+                    continue;
+                }
+
+                if (in_batch)
+                    --in_batch;
+                v = read_payload(tag);
+                return true;
+            }
+        }
+
+        // Read the next batch written with value_writer::write_batch().
+        // Returns false at the end of the stream.
+        auto read_batch(std::vector<value> &values) -> bool {
+            if (!start() || (cur == end && !fill(1)))
+                return false;
+
+            if (get_byte() != detail::value_tag_batch)
+                throw value_format_error("sk::value_reader: expected a batch");
+
+            auto n = get_varint();
+            values.clear();
+            values.reserve(static_cast<std::size_t>(
+                std::min<std::uint64_t>(n, 1 << 16)));
+            while (n--)
+                values.push_back(read_payload(get_byte()));
+            return true;
+        }
+
+    private:
+        int fd = -1;
+        std::vector<std::byte> chunk;
+        std::byte const *cur, *end;
+        std::uint64_t in_batch = 0;
+        bool started = false;
+
+        // Make at least n bytes available; returns false at end of input.
+        auto fill(std::size_t n) -> bool {
+            auto remaining = static_cast<std::size_t>(end - cur);
+            if (remaining >= n)
+                return true;
+            if (fd < 0)
+                return false;
+
+            // Move the unread bytes to the front of the buffer and refill.
+            auto *base = chunk.data();
+            std::memmove(base, cur, remaining);
+            if (chunk.size() < n)
+                chunk.resize(n);
+            base = chunk.data();
+            cur = base;
+            end = base + remaining;
+
+            while (remaining < n) {
+                auto r = detail::value_sys_read(
+                    fd, base + remaining, chunk.size() - remaining);
+                if (r == 0)
+                    return false;
+                remaining += r;
+                end = base + remaining;
+            }
+            return true;
+        }
+
+        void need(std::size_t n) {
+            if (static_cast<std::size_t>(end - cur) < n && !fill(n))
+                throw value_format_error("sk::value_reader: truncated value");
+        }
+
+        auto start() -> bool {
+            if (started)
+                return true;
+            if (!fill(sizeof(detail::value_binary_magic)))
+                return false;
+            if (std::memcmp(cur, detail::value_binary_magic,
+                            sizeof(detail::value_binary_magic) - 1) != 0)
+                throw value_format_error("sk::value_reader: bad magic");
+            if (cur[3] != detail::value_binary_magic[3])
+                throw value_format_error(
+                    "sk::value_reader: unsupported version");
+            cur += sizeof(detail::value_binary_magic);
+            started = true;
+            return true;
+        }
+
+        auto get_byte() -> unsigned char {
+            need(1);
+            return static_cast<unsigned char>(*cur++);
+        }
+
+        auto get_varint() -> std::uint64_t {
+            std::uint64_t u = 0;
+            for (int shift = 0; shift < 64; shift += 7) {
+                auto b = get_byte();
+                u |= static_cast<std::uint64_t>(b & 0x7F) << shift;
+                if (!(b & 0x80))
+                    return u;
+            }
+            throw value_format_error("sk::value_reader: invalid varint");
+        }
+
+        template <std::unsigned_integral U> auto get_fixed() -> U {
+            need(sizeof(U));
+            U u = 0;
+            for (std::size_t i = 0; i < sizeof(U); ++i)
+                u |= static_cast<U>(static_cast<unsigned char>(cur[i]))
+                     << (i * CHAR_BIT);
+            cur += sizeof(U);
+            return u;
+        }
+
+        void get_bytes(std::string &s, std::uint64_t n) {
+            s.clear();
+            while (n) {
+                if (cur == end && !fill(1))
+                    throw value_format_error(
+                        "sk::value_reader: truncated value");
+                auto len = static_cast<std::size_t>(std::min<std::uint64_t>(
+                    n, static_cast<std::size_t>(end - cur)));
+                s.append(reinterpret_cast<char const *>(cur), len);
+                cur += len;
+                n -= len;
+            }
+        }
+
+        template <typename T> auto get_integer() -> T {
+            if constexpr (std::signed_integral<T>) {
+                auto i = detail::value_unzigzag(get_varint());
+                if (!std::in_range<T>(i))
+                    throw value_format_error(
+                        "sk::value_reader: integer out of range");
+                return static_cast<T>(i);
+            } else {
+                auto u = get_varint();
+                if (!std::in_range<T>(u))
+                    throw value_format_error(
+                        "sk::value_reader: integer out of range");
+                return static_cast<T>(u);
+            }
+        }
+
+        template <typename T>
+        auto read_one(unsigned char tag, value &v) -> bool {
+            if (tag != detail::value_binary_type<T>::tag)
+                return false;
+
+            if constexpr (std::same_as<T, char>)
+                v = static_cast<char>(get_byte());
+            else if constexpr (std::integral<T>)
+                v = get_integer<T>();
+            else if constexpr (std::same_as<T, float>)
+                v = std::bit_cast<float>(get_fixed<std::uint32_t>());
+            else if constexpr (std::same_as<T, double>)
+                v = std::bit_cast<double>(get_fixed<std::uint64_t>());
+            else {
+                std::string s;
+                get_bytes(s, get_varint());
+                v = std::move(s);
+            }
+            return true;
+        }
+
+        auto read_payload(unsigned char tag) -> value {
+            switch (tag) {
+            case detail::value_tag_empty:
+                return value();
+            case detail::value_tag_false:
+                return value(false);
+            case detail::value_tag_true:
+                return value(true);
+            case detail::value_tag_user:
+                return read_user();
+            }
+
+            value v;
+            if (!(read_one<char>(tag, v) || read_one<signed char>(tag, v) ||
+                  read_one<short>(tag, v) || read_one<int>(tag, v) ||
+                  read_one<long>(tag, v) || read_one<long long>(tag, v) ||
+                  read_one<unsigned char>(tag, v) ||
+                  read_one<unsigned short>(tag, v) ||
+                  read_one<unsigned int>(tag, v) ||
+                  read_one<unsigned long>(tag, v) ||
+                  read_one<unsigned long long>(tag, v) ||
+                  read_one<float>(tag, v) || read_one<double>(tag, v) ||
+                  read_one<std::string>(tag, v)))
+                throw value_format_error("sk::value_reader: unknown tag");
+            return v;
+        }
+
+        auto read_user() -> value {
+            auto id = get_varint();
+            std::string bytes;
+            get_bytes(bytes, get_varint());
+
+            auto e = id > UINT32_MAX ? nullptr
+                                     : value_type_registry::global().find(
+                                           static_cast<std::uint32_t>(id));
+            if (!e)
+                throw value_format_error(
+                    "sk::value_reader: type is not registered");
+            return e->decode(bytes);
+        }
+    };
+
+} // namespace sk
+
+#endif // SK_VALUE_BINARY_HXX_INCLUDED
@@ -0,0 +1,364 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef SK_VALUE_CONVERT_HXX_INCLUDED
+#define SK_VALUE_CONVERT_HXX_INCLUDED
+
+#include <atomic>
+#include <charconv>
+#include <cmath>
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+#include "sk/value.hxx"
+
+/*
+ * value_convert - convert a value to a type other than the one it holds.
+ *
+ * value_cast<To> only succeeds if the value holds exactly a To.
+ * value_convert<To> also converts between the built-in arithmetic types and
+ * std::string, and between any pair of types for which a converter has been
+ * registered with register_value_converter():
+ *
+ *   - Integers and floating point values convert to each other as long as
+ *     the value is representable exactly: converting 300 to unsigned char,
+ *     1.5 to int, -1 to unsigned or 2^24 + 1 to float fails.  A floating
+ *     point value converts to a narrower floating point type if it is in
+ *     range, and is rounded to the nearest representable value, so 0.1
+ *     converts to float.  bool converts to and from 0 and 1.
+ *   - Numbers convert to strings with std::to_chars, and strings to numbers
+ *     with std::from_chars, which must consume the whole string.  bool
+ *     converts to and from "true" and "false".
+ *   - A value which already holds a To is returned as is.
+ *
+ * If there is no conversion from the value's type, value_convert throws
+ * std::bad_cast; if the conversion exists but fails for this value, it
+ * throws std::invalid_argument.  try_value_convert() returns std::nullopt
+ * in both cases instead.
+ *
+ * The converter for a pair of types is looked up in the registry the first
+ * time it is needed, and each thread caches the last converter it used for
+ * each target type, so converting a column of values of the same type costs
+ * one indirect call per value.
+ */
+
+namespace sk {
+
+    namespace detail {
+
+        template <typename T>
+        inline constexpr bool value_convert_number =
+            std::is_arithmetic_v<T> && !std::same_as<T, char> &&
+            !std::same_as<T, wchar_t> && !std::same_as<T, char8_t> &&
+            !std::same_as<T, char16_t> && !std::same_as<T, char32_t>;
+
+        template <typename From, typename To>
+        auto value_convert_number_to(From f, To &t) -> bool {
+            if constexpr (std::same_as<To, bool>) {
+                if (f != From(0) && f != From(1))
+                    return false;
+                t = f == From(1);
+                return true;
+            } else if constexpr (std::same_as<From, bool>) {
+                t = f ? To(1) : To(0);
+                return true;
+            } else if constexpr (std::integral<From> && std::integral<To>) {
+                if (!std::in_range<To>(f))
+                    return false;
+                t = static_cast<To>(f);
+                return true;
+            } else if constexpr (std::floating_point<From> &&
+                                 std::integral<To>) {
+                // The range of To is [lower, upper).
+                auto upper =
+                    std::ldexp(From(1), std::numeric_limits<To>::digits);
+                auto lower = std::is_signed_v<To> ? -upper : From(0);
+                if (!(f >= lower && f < upper) || std::trunc(f) != f)
+                    return false;
+                t = static_cast<To>(f);
+                return true;
+            } else if constexpr (std::integral<From> &&
+                                 std::floating_point<To>) {
+                // Rounding may carry t up to 2^digits, which does not fit
+                // in From, so check the range before converting back.
+                t = static_cast<To>(f);
+                auto upper =
+                    std::ldexp(To(1), std::numeric_limits<From>::digits);
+                return t < upper && static_cast<From>(t) == f;
+            } else if constexpr (std::floating_point<From> &&
+                                 std::floating_point<To> &&
+                                 (sizeof(To) < sizeof(From))) {
+                if (std::isfinite(f) &&
+                    std::fabs(f) > std::numeric_limits<To>::max())
+                    return false;
+                t = static_cast<To>(f);
+                return true;
+            } else {
+                t = static_cast<To>(f);
+                return true;
+            }
+        }
+
+        template <typename From>
+        auto value_convert_to_string(From f, std::string &t) -> bool {
+            if constexpr (std::same_as<From, bool>) {
+                t = f ? "true" : "false";
+            } else {
+                char buf[64];
+                auto r = std::to_chars(buf, buf + sizeof(buf), f);
+                if (r.ec != std::errc())
+                    return false;
+                t.assign(buf, r.ptr);
+            }
+            return true;
+        }
+
+        template <typename To>
+        auto value_convert_from_string(std::string_view s, To &t) -> bool {
+            if constexpr (std::same_as<To, bool>) {
+                if (s == "true")
+                    t = true;
+                else if (s == "false")
+                    t = false;
+                else
+                    return false;
+                return true;
+            } else {
+                auto const *end = s.data() + s.size();
+                auto r = std::from_chars(s.data(), end, t);
+                return r.ec == std::errc() && r.ptr == end;
+            }
+        }
+
+        // A converter from the value's object to a To.
+        template <typename To>
+        using value_converter = std::function<bool(value const &, To &)>;
+
+        // The built-in conversion from From to To, if there is one.
+        template <typename From, typename To>
+        auto value_builtin_converter() -> value_converter<To> {
+            if constexpr (std::same_as<From, To>) {
+                return [](value const &v, To &t) {
+                    t = *value_cast<To>(&v);
+                    return true;
+                };
+            } else if constexpr (std::same_as<From, std::string> &&
+                                 value_convert_number<To>) {
+                return [](value const &v, To &t) {
+                    return value_convert_from_string(*value_string_view(v), t);
+                };
+            } else if constexpr (value_convert_number<From> &&
+                                 std::same_as<To, std::string>) {
+                return [](value const &v, To &t) {
+                    return value_convert_to_string(*value_cast<From>(&v), t);
+                };
+            } else if constexpr (value_convert_number<From> &&
+                                 value_convert_number<To>) {
+                return [](value const &v, To &t) {
+                    return value_convert_number_to(*value_cast<From>(&v), t);
+                };
+            } else {
+                return nullptr;
+            }
+        }
+
+        template <typename To, typename... Froms>
+        auto value_builtin_converter_for(void const *tag)
+            -> value_converter<To> {
+            value_converter<To> c;
+            ((tag == &value_type_tag<Froms> &&
+              (c = value_builtin_converter<Froms, To>(), true)) ||
+             ...);
+            return c;
+        }
+
+    } // namespace detail
+
+    /*
+     * The registry of conversions.  Converters are usually registered once
+     * at startup with register_value_converter().
+     */
+    class value_converter_registry {
+    public:
+        static auto global() -> value_converter_registry & {
+            static value_converter_registry registry;
+            return registry;
+        }
+
+        // Register a conversion from From to To, replacing any existing
+        // conversion between the two types.  The converter returns false if
+        // it cannot convert its argument.
+        template <value_containable From, typename To>
+        void add(std::function<bool(From const &, To &)> convert) {
+            auto c = std::make_shared<detail::value_converter<To>>(
+                [convert = std::move(convert)](value const &v, To &t) {
+                    return convert(*value_cast<From>(&v), t);
+                });
+
+            std::unique_lock lock(mutex);
+            converters[{&value_type_tag<From>, &value_type_tag<To>}] = c;
+            // Cached pointers may still refer to the old converter.
+            retained.push_back(std::move(c));
+            generation.fetch_add(1, std::memory_order_release);
+        }
+
+        // The converter from the type identified by from_tag to To, or
+        // nullptr if there is none.  The converter lives as long as the
+        // registry.
+        template <typename To>
+        auto find(void const *from_tag) -> detail::value_converter<To> const * {
+            std::pair key{from_tag, static_cast<void const *>(
+                                        &value_type_tag<To>)};
+            {
+                std::shared_lock lock(mutex);
+                if (auto it = converters.find(key); it != converters.end())
+                    return static_cast<detail::value_converter<To> const *>(
+                        it->second.get());
+            }
+
+            // Not looked up yet: remember the built-in conversion, or its
+            // absence.
+            auto builtin = detail::value_builtin_converter_for<
+                To, bool, signed char, unsigned char, short, unsigned short,
+                int, unsigned int, long, unsigned long, long long,
+                unsigned long long, float, double, long double, std::string>(
+                from_tag);
+            std::shared_ptr<void> c;
+            if (builtin)
+                c = std::make_shared<detail::value_converter<To>>(
+                    std::move(builtin));
+
+            std::unique_lock lock(mutex);
+            auto [it, inserted] = converters.try_emplace(key, c);
+            if (inserted && c)
+                retained.push_back(std::move(c));
+            return static_cast<detail::value_converter<To> const *>(
+                it->second.get());
+        }
+
+        // Incremented whenever a converter is registered.
+        auto current_generation() const -> std::uint64_t {
+            return generation.load(std::memory_order_acquire);
+        }
+
+    private:
+        mutable std::shared_mutex mutex;
+        std::map<std::pair<void const *, void const *>, std::shared_ptr<void>>
+            converters;
+        std::vector<std::shared_ptr<void>> retained;
+        std::atomic<std::uint64_t> generation{0};
+    };
+
+    // Register a conversion from From to To with the global registry.
+    template <value_containable From, typename To>
+    void register_value_converter(
+        std::function<bool(From const &, To &)> convert) {
+        value_converter_registry::global().add<From, To>(std::move(convert));
+    }
+
+    namespace detail {
+
+        // The converter for v's type, through this thread's cache.
+        template <typename To>
+        auto value_find_converter(value const &v)
+            -> value_converter<To> const * {
+            struct cache_entry {
+                void const *tag = nullptr;
+                std::uint64_t generation = 0;
+                value_converter<To> const *converter = nullptr;
+            };
+            thread_local cache_entry cache;
+
+            auto &registry = value_converter_registry::global();
+            auto const *tag = v.object->type_tag();
+            auto generation = registry.current_generation();
+            if (cache.tag != tag || cache.generation != generation) {
+                cache.converter = registry.find<To>(tag);
+                cache.tag = tag;
+                cache.generation = generation;
+            }
+            return cache.converter;
+        }
+
+        // If v already holds a To (of any type, not only the built-in
+        // ones), a pointer to it; otherwise nullptr.
+        template <typename To>
+        auto value_convert_same(value const &v) -> To const * {
+            if constexpr (value_containable<To>) {
+                if (v.object->type_tag() == &value_type_tag<To>)
+                    return value_cast<To>(&v);
+            }
+            return nullptr;
+        }
+
+    } // namespace detail
+
+    // Convert v to a To, or return std::nullopt if it cannot be converted.
+    template <typename To>
+    auto try_value_convert(value const &v) -> std::optional<To> {
+        if (auto const *same = detail::value_convert_same<To>(v))
+            return *same;
+        auto const *c = detail::value_find_converter<To>(v);
+        To t{};
+        if (!c || !(*c)(v, t))
+            return std::nullopt;
+        return t;
+    }
+
+    // Convert v to a To.
+    template <typename To> auto value_convert(value const &v) -> To {
+        if (auto const *same = detail::value_convert_same<To>(v))
+            return *same;
+        auto const *c = detail::value_find_converter<To>(v);
+        if (!c)
+            throw std::bad_cast();
+        To t{};
+        if (!(*c)(v, t))
+            throw std::invalid_argument(
+                "sk::value_convert: value cannot be converted");
+        return t;
+    }
+
+} // namespace sk
+
+#endif // SK_VALUE_CONVERT_HXX_INCLUDED
@@ -0,0 +1,498 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef SK_VALUE_FILTER_HXX_INCLUDED
+#define SK_VALUE_FILTER_HXX_INCLUDED
+
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#if (defined(__GNUC__) || defined(__clang__)) &&                               \
+    (defined(__x86_64__) || defined(__i386__))
+#    include <immintrin.h>
+#    define SK_VALUE_FILTER_X86 1
+#endif
+
+#include "sk/value.hxx"
+
+/*
+ * compare_column - compare a column of values against a literal.
+ *
+ * compare_column(column, op, literal, bitmap) sets bit i of the bitmap
+ * (bit i % 64 of word i / 64) when column[i] op literal is true, and
+ * clears it otherwise.  The bitmap must have value_bitmap_words(n) words.
+ *
+ * The operators are those of sk::value: == and <, with > meaning
+ * literal < cell, <= meaning !(literal < cell), and >= meaning
+ * !(cell < literal).  Values of different types are unequal and ordered
+ * by type, and the empty value orders first.
+ *
+ * The literal's type is examined once.  Runs of cells of the same type as
+ * the literal are collected into an array and compared by a vector kernel
+ * (AVX2 or SSE4.2, chosen when first used according to what the
+ * processor supports) for int, long long and double, or by a plain loop
+ * for other types.  String literals are compared directly against the
+ * characters of string cells.  Only cells of other types are compared one
+ * at a time through sk::value's operators.
+ *
+ * compare_column() also accepts a plain column of T with a T literal.
+ */
+
+namespace sk {
+
+    enum struct value_compare_op { eq, ne, lt, le, gt, ge };
+
+    // The number of words in a bitmap with a bit for each of n rows.
+    constexpr auto value_bitmap_words(std::size_t n) -> std::size_t {
+        return (n + 63) / 64;
+    }
+
+    namespace detail {
+
+        // What the kernels evaluate: cell == literal, cell < literal or
+        // literal < cell.  The other operators are their complements.
+        enum struct value_filter_pred { eq, lt, gt };
+
+        constexpr auto value_filter_split(value_compare_op op)
+            -> std::pair<value_filter_pred, bool> {
+            switch (op) {
+            case value_compare_op::eq:
+                return {value_filter_pred::eq, false};
+            case value_compare_op::ne:
+                return {value_filter_pred::eq, true};
+            case value_compare_op::lt:
+                return {value_filter_pred::lt, false};
+            case value_compare_op::ge:
+                return {value_filter_pred::lt, true};
+            case value_compare_op::gt:
+                return {value_filter_pred::gt, false};
+            case value_compare_op::le:
+                return {value_filter_pred::gt, true};
+            }
+            throw std::invalid_argument("compare_column: invalid operator");
+        }
+
+        // Bits [0, n) set.
+        constexpr auto value_filter_low_bits(std::size_t n) -> std::uint64_t {
+            return n >= 64 ? ~std::uint64_t(0)
+                           : (std::uint64_t(1) << n) - 1;
+        }
+
+        // The kernel type for T: a run of T is compared as an array of K.
+        template <typename T>
+        using value_filter_kernel_type = std::conditional_t<
+            std::is_integral_v<T> && std::is_signed_v<T> && sizeof(T) == 4,
+            std::int32_t,
+            std::conditional_t<std::is_integral_v<T> && std::is_signed_v<T> &&
+                                   sizeof(T) == 8,
+                               std::int64_t, T>>;
+
+        template <typename K>
+        inline constexpr bool value_filter_vectorised =
+            std::same_as<K, std::int32_t> || std::same_as<K, std::int64_t> ||
+            std::same_as<K, double>;
+
+        // Compare up to 64 objects, returning bit i set if in[i] matches.
+        template <typename K>
+        auto value_filter_scalar(K const *in, std::size_t n, K const &literal,
+                                 value_filter_pred pred) -> std::uint64_t {
+            std::uint64_t mask = 0;
+            for (std::size_t i = 0; i < n; ++i) {
+                bool match;
+                switch (pred) {
+                case value_filter_pred::eq:
+                    match = in[i] == literal;
+                    break;
+                case value_filter_pred::lt:
+                    match = value_lt_compare(in[i], literal);
+                    break;
+                default:
+                    match = value_lt_compare(literal, in[i]);
+                    break;
+                }
+                mask |= std::uint64_t(match) << i;
+            }
+            return mask;
+        }
+
+        template <typename K>
+        using value_filter_kernel = std::uint64_t (*)(K const *, std::size_t,
+                                                      K const &,
+                                                      value_filter_pred);
+
+#ifdef SK_VALUE_FILTER_X86
+        /*
+         * AVX2 kernels.  Each step compares one register of objects and
+         * appends the register's movemask to the result.
+         */
+        __attribute__((target("avx2"))) inline auto
+        value_filter_avx2(std::int32_t const *in, std::size_t n,
+                          std::int32_t const &literal, value_filter_pred pred)
+            -> std::uint64_t {
+            auto const lit = _mm256_set1_epi32(literal);
+            std::uint64_t mask = 0;
+            std::size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                auto v = _mm256_loadu_si256(
+                    reinterpret_cast<__m256i const *>(in + i));
+                auto m = pred == value_filter_pred::eq
+                             ? _mm256_cmpeq_epi32(v, lit)
+                         : pred == value_filter_pred::lt
+                             ? _mm256_cmpgt_epi32(lit, v)
+                             : _mm256_cmpgt_epi32(v, lit);
+                mask |= std::uint64_t(unsigned(
+                            _mm256_movemask_ps(_mm256_castsi256_ps(m))))
+                        << i;
+            }
+            if (i < n)
+                mask |= value_filter_scalar(in + i, n - i, literal, pred) << i;
+            return mask;
+        }
+
+        __attribute__((target("avx2"))) inline auto
+        value_filter_avx2(std::int64_t const *in, std::size_t n,
+                          std::int64_t const &literal, value_filter_pred pred)
+            -> std::uint64_t {
+            auto const lit = _mm256_set1_epi64x(literal);
+            std::uint64_t mask = 0;
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                auto v = _mm256_loadu_si256(
+                    reinterpret_cast<__m256i const *>(in + i));
+                auto m = pred == value_filter_pred::eq
+                             ? _mm256_cmpeq_epi64(v, lit)
+                         : pred == value_filter_pred::lt
+                             ? _mm256_cmpgt_epi64(lit, v)
+                             : _mm256_cmpgt_epi64(v, lit);
+                mask |= std::uint64_t(unsigned(
+                            _mm256_movemask_pd(_mm256_castsi256_pd(m))))
+                        << i;
+            }
+            if (i < n)
+                mask |= value_filter_scalar(in + i, n - i, literal, pred) << i;
+            return mask;
+        }
+
+        __attribute__((target("avx2"))) inline auto
+        value_filter_avx2(double const *in, std::size_t n,
+                          double const &literal, value_filter_pred pred)
+            -> std::uint64_t {
+            auto const lit = _mm256_set1_pd(literal);
+            std::uint64_t mask = 0;
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                auto v = _mm256_loadu_pd(in + i);
+                auto m = pred == value_filter_pred::eq
+                             ? _mm256_cmp_pd(v, lit, _CMP_EQ_OQ)
+                         : pred == value_filter_pred::lt
+                             ? _mm256_cmp_pd(v, lit, _CMP_LT_OQ)
+                             : _mm256_cmp_pd(v, lit, _CMP_GT_OQ);
+                mask |= std::uint64_t(unsigned(_mm256_movemask_pd(m))) << i;
+            }
+            if (i < n)
+                mask |= value_filter_scalar(in + i, n - i, literal, pred) << i;
+            return mask;
+        }
+
+        /*
+         * SSE4.2 kernels, for _mm_cmpgt_epi64.
+         */
+        __attribute__((target("sse4.2"))) inline auto
+        value_filter_sse42(std::int32_t const *in, std::size_t n,
+                           std::int32_t const &literal, value_filter_pred pred)
+            -> std::uint64_t {
+            auto const lit = _mm_set1_epi32(literal);
+            std::uint64_t mask = 0;
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                auto v =
+                    _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + i));
+                auto m = pred == value_filter_pred::eq ? _mm_cmpeq_epi32(v, lit)
+                         : pred == value_filter_pred::lt
+                             ? _mm_cmplt_epi32(v, lit)
+                             : _mm_cmpgt_epi32(v, lit);
+                mask |= std::uint64_t(unsigned(
+                            _mm_movemask_ps(_mm_castsi128_ps(m))))
+                        << i;
+            }
+            if (i < n)
+                mask |= value_filter_scalar(in + i, n - i, literal, pred) << i;
+            return mask;
+        }
+
+        __attribute__((target("sse4.2"))) inline auto
+        value_filter_sse42(std::int64_t const *in, std::size_t n,
+                           std::int64_t const &literal, value_filter_pred pred)
+            -> std::uint64_t {
+            auto const lit = _mm_set1_epi64x(literal);
+            std::uint64_t mask = 0;
+            std::size_t i = 0;
+            for (; i + 2 <= n; i += 2) {
+                auto v =
+                    _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + i));
+                auto m = pred == value_filter_pred::eq ? _mm_cmpeq_epi64(v, lit)
+                         : pred == value_filter_pred::lt
+                             ? _mm_cmpgt_epi64(lit, v)
+                             : _mm_cmpgt_epi64(v, lit);
+                mask |= std::uint64_t(unsigned(
+                            _mm_movemask_pd(_mm_castsi128_pd(m))))
+                        << i;
+            }
+            if (i < n)
+                mask |= value_filter_scalar(in + i, n - i, literal, pred) << i;
+            return mask;
+        }
+
+        __attribute__((target("sse4.2"))) inline auto
+        value_filter_sse42(double const *in, std::size_t n,
+                           double const &literal, value_filter_pred pred)
+            -> std::uint64_t {
+            auto const lit = _mm_set1_pd(literal);
+            std::uint64_t mask = 0;
+            std::size_t i = 0;
+            for (; i + 2 <= n; i += 2) {
+                auto v = _mm_loadu_pd(in + i);
+                auto m = pred == value_filter_pred::eq ? _mm_cmpeq_pd(v, lit)
+                         : pred == value_filter_pred::lt ? _mm_cmplt_pd(v, lit)
+                                                         : _mm_cmpgt_pd(v, lit);
+                mask |= std::uint64_t(unsigned(_mm_movemask_pd(m))) << i;
+            }
+            if (i < n)
+                mask |= value_filter_scalar(in + i, n - i, literal, pred) << i;
+            return mask;
+        }
+#endif
+
+        // The widest kernel for K which the processor supports.
+        template <typename K>
+        auto value_filter_kernel_for_cpu() -> value_filter_kernel<K> {
+            static value_filter_kernel<K> const kernel =
+                []() -> value_filter_kernel<K> {
+#ifdef SK_VALUE_FILTER_X86
+                if constexpr (value_filter_vectorised<K>) {
+                    __builtin_cpu_init();
+                    if (__builtin_cpu_supports("avx2"))
+                        return [](K const *in, std::size_t n, K const &lit,
+                                  value_filter_pred pred) {
+                            return value_filter_avx2(in, n, lit, pred);
+                        };
+                    if (__builtin_cpu_supports("sse4.2"))
+                        return [](K const *in, std::size_t n, K const &lit,
+                                  value_filter_pred pred) {
+                            return value_filter_sse42(in, n, lit, pred);
+                        };
+                }
+#endif
+                return value_filter_scalar<K>;
+            }();
+            return kernel;
+        }
+
+        inline void value_filter_check_sizes(std::size_t rows,
+                                             std::size_t words) {
+            if (words != value_bitmap_words(rows))
+                throw std::invalid_argument(
+                    "compare_column: bitmap size does not match column size");
+        }
+
+        // Store the n-bit mask for rows [i, i + n) in a bitmap whose bits
+        // from i onwards are all clear.  n is at most 64.
+        inline void value_filter_store(std::span<std::uint64_t> bitmap,
+                                       std::size_t i, std::size_t n,
+                                       std::uint64_t mask) {
+            mask &= value_filter_low_bits(n);
+            auto word = i / 64, offset = i % 64;
+            bitmap[word] |= mask << offset;
+            if (offset != 0 && n > 64 - offset)
+                bitmap[word + 1] |= mask >> (64 - offset);
+        }
+
+    } // namespace detail
+
+    // Compare a plain column of T against a literal T.
+    template <value_containable T>
+    void compare_column(std::span<T const> column, value_compare_op op,
+                        T const &literal, std::span<std::uint64_t> bitmap) {
+        detail::value_filter_check_sizes(column.size(), bitmap.size());
+
+        using K = detail::value_filter_kernel_type<T>;
+        auto [pred, invert] = detail::value_filter_split(op);
+        auto kernel = detail::value_filter_kernel_for_cpu<K>();
+        auto const lit = static_cast<K>(literal);
+
+        for (std::size_t i = 0; i < column.size(); i += 64) {
+            auto n = std::min<std::size_t>(64, column.size() - i);
+            std::uint64_t mask;
+            if constexpr (std::same_as<K, T>) {
+                mask = kernel(column.data() + i, n, lit, pred);
+            } else {
+                K batch[64];
+                for (std::size_t j = 0; j < n; ++j)
+                    batch[j] = static_cast<K>(column[i + j]);
+                mask = kernel(batch, n, lit, pred);
+            }
+            if (invert)
+                mask = ~mask;
+            bitmap[i / 64] = mask & detail::value_filter_low_bits(n);
+        }
+    }
+
+    namespace detail {
+
+        // Compare one cell through sk::value's operators.
+        inline auto value_filter_one(value const &cell, value const &literal,
+                                     value_filter_pred pred) -> bool {
+            switch (pred) {
+            case value_filter_pred::eq:
+                return cell == literal;
+            case value_filter_pred::lt:
+                return cell < literal;
+            default:
+                return literal < cell;
+            }
+        }
+
+        // Compare every cell, collecting runs of cells of type T.
+        template <typename T>
+        void value_filter_typed(std::span<value const> column,
+                                value const &literal, value_filter_pred pred,
+                                bool invert, std::span<std::uint64_t> bitmap) {
+            using K = value_filter_kernel_type<T>;
+            auto kernel = value_filter_kernel_for_cpu<K>();
+            auto const lit = static_cast<K>(*value_cast<T>(&literal));
+
+            std::size_t i = 0;
+            while (i < column.size()) {
+                K batch[64];
+                std::size_t n = 0;
+                for (; n < 64 && i + n < column.size(); ++n) {
+                    auto const &cell = column[i + n];
+                    if (cell.object->type_tag() != &value_type_tag<T>)
+                        break;
+                    batch[n] = static_cast<K>(*value_cast<T>(&cell));
+                }
+
+                if (n != 0) {
+                    auto mask = kernel(batch, n, lit, pred);
+                    value_filter_store(bitmap, i, n, invert ? ~mask : mask);
+                    i += n;
+                } else {
+                    bool match =
+                        value_filter_one(column[i], literal, pred) != invert;
+                    value_filter_store(bitmap, i, 1, match);
+                    ++i;
+                }
+            }
+        }
+
+        inline void value_filter_string(std::span<value const> column,
+                                        value const &literal,
+                                        value_filter_pred pred, bool invert,
+                                        std::span<std::uint64_t> bitmap) {
+            auto lit = *value_string_view(literal);
+            for (std::size_t i = 0; i < column.size(); ++i) {
+                bool match;
+                if (auto s = value_string_view(column[i])) {
+                    switch (pred) {
+                    case value_filter_pred::eq:
+                        match = *s == lit;
+                        break;
+                    case value_filter_pred::lt:
+                        match = *s < lit;
+                        break;
+                    default:
+                        match = lit < *s;
+                        break;
+                    }
+                } else {
+                    match = value_filter_one(column[i], literal, pred);
+                }
+                value_filter_store(bitmap, i, 1, match != invert);
+            }
+        }
+
+        template <typename... Ts> struct value_filter_types {
+            // Filter with value_filter_typed<T> if the literal has a type T
+            // in Ts.
+            static auto run(void const *tag, std::span<value const> column,
+                            value const &literal, value_filter_pred pred,
+                            bool invert, std::span<std::uint64_t> bitmap)
+                -> bool {
+                return ((tag == &value_type_tag<Ts> &&
+                         (value_filter_typed<Ts>(column, literal, pred, invert,
+                                                 bitmap),
+                          true)) ||
+                        ...);
+            }
+        };
+
+        using value_filter_batched =
+            value_filter_types<int, long, long long, double, float, unsigned,
+                               unsigned long, unsigned long long, short,
+                               unsigned short, signed char, unsigned char,
+                               char, bool>;
+
+    } // namespace detail
+
+    // Compare each value in column against literal.
+    inline void compare_column(std::span<value const> column,
+                               value_compare_op op, value const &literal,
+                               std::span<std::uint64_t> bitmap) {
+        detail::value_filter_check_sizes(column.size(), bitmap.size());
+        std::fill(bitmap.begin(), bitmap.end(), 0);
+
+        auto [pred, invert] = detail::value_filter_split(op);
+        auto const *tag = literal.object->type_tag();
+
+        if (detail::value_filter_batched::run(tag, column, literal, pred,
+                                              invert, bitmap))
+            return;
+
+        if (value_string_view(literal)) {
+            detail::value_filter_string(column, literal, pred, invert, bitmap);
+            return;
+        }
+
+        for (std::size_t i = 0; i < column.size(); ++i) {
+            bool match = detail::value_filter_one(column[i], literal, pred);
+            detail::value_filter_store(bitmap, i, 1, match != invert);
+        }
+    }
+
+} // namespace sk
+
+#endif // SK_VALUE_FILTER_HXX_INCLUDED
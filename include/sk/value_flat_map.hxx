@@ -0,0 +1,699 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SK_VALUE_FLAT_MAP_HXX_INCLUDED
+#define SK_VALUE_FLAT_MAP_HXX_INCLUDED
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define SK_VALUE_FLAT_MAP_SSE2 1
+#endif
+
+#include "sk/value.hxx"
+
+/*
+ * value_flat_map, value_flat_set - open-addressing hash containers keyed by
+ * sk::value.
+ *
+ * The slots are stored in a single flat array alongside one control byte per
+ * slot.  A control byte is either empty, deleted, or holds the low 7 bits of
+ * the key's hash.  Lookup compares those 7 bits against a group of 16 control
+ * bytes at once and only compares keys where the fragment matches, so most
+ * probes never call value::eq().
+ *
+ * Lookup is heterogeneous: find(42) hashes the int directly and compares it
+ * against the stored object without constructing a temporary sk::value.
+ * Strings may be looked up by std::string_view or char const *, which match
+ * stored std::string keys.
+ */
+
+namespace sk {
+
+    namespace detail {
+
+        using value_flat_ctrl = std::int8_t;
+
+        inline constexpr value_flat_ctrl value_flat_empty = -128;
+        inline constexpr value_flat_ctrl value_flat_deleted = -2;
+        inline constexpr std::size_t value_flat_group_width = 16;
+
+        // A group of 16 control bytes; each match returns a bitmask with
+        // bit i set if control byte i matches.
+        struct value_flat_group {
+            value_flat_ctrl const *ctrl;
+
+#ifdef SK_VALUE_FLAT_MAP_SSE2
+            auto match(value_flat_ctrl h2) const -> std::uint32_t {
+                auto g =
+                    _mm_loadu_si128(reinterpret_cast<__m128i const *>(ctrl));
+                return static_cast<std::uint32_t>(
+                    _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), g)));
+            }
+
+            auto match_empty() const -> std::uint32_t {
+                return match(value_flat_empty);
+            }
+
+            // Empty and deleted bytes are the only ones with the sign bit
+            // set, so movemask finds them directly.
+            auto match_free() const -> std::uint32_t {
+                auto g =
+                    _mm_loadu_si128(reinterpret_cast<__m128i const *>(ctrl));
+                return static_cast<std::uint32_t>(_mm_movemask_epi8(g));
+            }
+#else
+            auto match(value_flat_ctrl h2) const -> std::uint32_t {
+                std::uint32_t r = 0;
+                for (std::size_t i = 0; i < value_flat_group_width; ++i)
+                    if (ctrl[i] == h2)
+                        r |= 1u << i;
+                return r;
+            }
+
+            auto match_empty() const -> std::uint32_t {
+                return match(value_flat_empty);
+            }
+
+            auto match_free() const -> std::uint32_t {
+                std::uint32_t r = 0;
+                for (std::size_t i = 0; i < value_flat_group_width; ++i)
+                    if (ctrl[i] < 0)
+                        r |= 1u << i;
+                return r;
+            }
+#endif
+        };
+
+        // Hash for keys and heterogeneous lookup keys.  Every key hashes the
+        // same as the sk::value holding it would.
+        struct value_flat_hash {
+            auto operator()(value const &v) const -> std::size_t {
+                return std::hash<value>{}(v);
+            }
+
+            template <value_containable T>
+            auto operator()(T const &v) const -> std::size_t {
+                return std::hash<T>{}(v);
+            }
+
+            auto operator()(std::string_view s) const -> std::size_t {
+                return std::hash<std::string_view>{}(s);
+            }
+
+            auto operator()(char const *s) const -> std::size_t {
+                return std::hash<std::string_view>{}(s);
+            }
+        };
+
+        // Equality between a stored key and a lookup key.  When the lookup
+        // key's type is known, this is a type check and a direct comparison
+        // of the stored object.
+        struct value_flat_equal {
+            auto operator()(value const &a, value const &b) const -> bool {
+                return a == b;
+            }
+
+            template <value_containable T>
+            auto operator()(value const &a, T const &b) const -> bool {
+                if constexpr (std::same_as<T, std::string>) {
+                    return (*this)(a, std::string_view(b));
+                } else {
+                    auto const *p = detail::value_probe<T>(&a);
+                    return p && *p == b;
+                }
+            }
+
+            auto operator()(value const &a, nullptr_t) const -> bool {
+                return a.empty();
+            }
+
+            auto operator()(value const &a, std::string_view b) const
+                -> bool {
+                auto s = value_string_view(a);
+                return s && *s == b;
+            }
+
+            auto operator()(value const &a, char const *b) const -> bool {
+                return (*this)(a, std::string_view(b));
+            }
+        };
+
+        // Spread the hash over all bits; std::hash of an integer is usually
+        // the identity, which would otherwise leave the 7-bit fragment equal
+        // to the low bits of the key.
+        inline auto value_flat_mix(std::size_t h) -> std::uint64_t {
+            auto m = static_cast<std::uint64_t>(h) * 0x9E3779B97F4A7C15ull;
+            return m ^ (m >> 32);
+        }
+
+        /*
+         * The table shared by value_flat_map and value_flat_set.  Policy
+         * supplies the slot type and how to get the key from a slot.
+         */
+        template <typename Policy> class value_flat_table {
+        public:
+            using slot_type = typename Policy::slot_type;
+            using size_type = std::size_t;
+
+            template <bool Const> class basic_iterator {
+                friend class value_flat_table;
+
+                using table_ptr = std::conditional_t<Const,
+                                                     value_flat_table const *,
+                                                     value_flat_table *>;
+                table_ptr table = nullptr;
+                size_type index = 0;
+
+                basic_iterator(table_ptr t, size_type i) : table(t), index(i) {
+                    skip();
+                }
+
+                void skip() {
+                    while (index < table->capacity_ && table->ctrl_[index] < 0)
+                        ++index;
+                }
+
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = slot_type;
+                using difference_type = std::ptrdiff_t;
+                // Set elements are never mutable through an iterator.
+                using element_type =
+                    std::conditional_t<Const || Policy::keys_only,
+                                       slot_type const, slot_type>;
+                using reference = element_type &;
+                using pointer = element_type *;
+
+                basic_iterator() = default;
+
+                // Allow conversion from iterator to const_iterator.
+                template <bool OtherConst>
+                requires(Const && !OtherConst)
+                    basic_iterator(basic_iterator<OtherConst> const &other)
+                    : table(other.table), index(other.index) {}
+
+                auto operator*() const -> reference {
+                    return table->slots_[index];
+                }
+
+                auto operator->() const -> pointer {
+                    return &table->slots_[index];
+                }
+
+                auto operator++() -> basic_iterator & {
+                    ++index;
+                    skip();
+                    return *this;
+                }
+
+                auto operator++(int) -> basic_iterator {
+                    auto r = *this;
+                    ++*this;
+                    return r;
+                }
+
+                auto operator==(basic_iterator const &other) const -> bool {
+                    return index == other.index;
+                }
+
+                friend class basic_iterator<true>;
+            };
+
+            using iterator = basic_iterator<false>;
+            using const_iterator = basic_iterator<true>;
+
+            value_flat_table() = default;
+
+            // Delegating makes the destructor clean up if a copy throws.
+            value_flat_table(value_flat_table const &other)
+                : value_flat_table() {
+                reserve(other.size_);
+                for (auto const &slot : other) {
+                    auto i = prepare_insert(hash_of(Policy::key(slot)));
+                    try {
+                        ::new (static_cast<void *>(slots_ + i))
+                            slot_type(slot);
+                    } catch (...) {
+                        set_ctrl(i, value_flat_deleted);
+                        --size_;
+                        throw;
+                    }
+                }
+            }
+
+            value_flat_table(value_flat_table &&other) noexcept
+                : ctrl_(std::exchange(other.ctrl_, nullptr)),
+                  slots_(std::exchange(other.slots_, nullptr)),
+                  capacity_(std::exchange(other.capacity_, 0)),
+                  size_(std::exchange(other.size_, 0)),
+                  growth_left_(std::exchange(other.growth_left_, 0)) {}
+
+            auto operator=(value_flat_table const &other)
+                -> value_flat_table & {
+                if (this != &other) {
+                    value_flat_table tmp(other);
+                    swap(tmp);
+                }
+                return *this;
+            }
+
+            auto operator=(value_flat_table &&other) noexcept
+                -> value_flat_table & {
+                value_flat_table tmp(std::move(other));
+                swap(tmp);
+                return *this;
+            }
+
+            ~value_flat_table() {
+                destroy();
+            }
+
+            void swap(value_flat_table &other) noexcept {
+                std::swap(ctrl_, other.ctrl_);
+                std::swap(slots_, other.slots_);
+                std::swap(capacity_, other.capacity_);
+                std::swap(size_, other.size_);
+                std::swap(growth_left_, other.growth_left_);
+            }
+
+            auto begin() -> iterator {
+                return iterator(this, 0);
+            }
+            auto end() -> iterator {
+                return iterator(this, capacity_);
+            }
+            auto begin() const -> const_iterator {
+                return const_iterator(this, 0);
+            }
+            auto end() const -> const_iterator {
+                return const_iterator(this, capacity_);
+            }
+
+            auto size() const -> size_type {
+                return size_;
+            }
+
+            auto empty() const -> bool {
+                return size_ == 0;
+            }
+
+            auto capacity() const -> size_type {
+                return capacity_;
+            }
+
+            void clear() {
+                destroy();
+                ctrl_ = nullptr;
+                slots_ = nullptr;
+                capacity_ = size_ = growth_left_ = 0;
+            }
+
+            // Make room for at least n elements without rehashing.
+            void reserve(size_type n) {
+                if (n <= size_ + growth_left_)
+                    return;
+                auto want = n + n / 7 + 1;
+                if (want < value_flat_group_width)
+                    want = value_flat_group_width;
+                resize(std::bit_ceil(want));
+            }
+
+            template <typename K> auto find(K const &key) -> iterator {
+                return iterator(this, find_index(key));
+            }
+
+            template <typename K>
+            auto find(K const &key) const -> const_iterator {
+                return const_iterator(this, find_index(key));
+            }
+
+            template <typename K> auto contains(K const &key) const -> bool {
+                return find_index(key) != capacity_;
+            }
+
+            template <typename K> auto count(K const &key) const -> size_type {
+                return contains(key) ? 1 : 0;
+            }
+
+            template <typename K> auto erase(K const &key) -> size_type {
+                auto i = find_index(key);
+                if (i == capacity_)
+                    return 0;
+                erase_index(i);
+                return 1;
+            }
+
+            auto erase(const_iterator it) -> iterator {
+                erase_index(it.index);
+                return iterator(this, it.index + 1);
+            }
+
+        protected:
+            // Find the key, or insert a slot constructed from make() if it is
+            // not present.
+            template <typename K, typename Make>
+            auto find_or_insert(K const &key, Make &&make)
+                -> std::pair<iterator, bool> {
+                auto h = hash_of(key);
+                if (auto i = find_index(key, h); i != capacity_)
+                    return {iterator(this, i), false};
+                auto i = prepare_insert(h);
+                try {
+                    ::new (static_cast<void *>(slots_ + i))
+                        slot_type(std::forward<Make>(make)());
+                } catch (...) {
+                    set_ctrl(i, value_flat_deleted);
+                    --size_;
+                    throw;
+                }
+                return {iterator(this, i), true};
+            }
+
+        private:
+            value_flat_ctrl *ctrl_ = nullptr;
+            slot_type *slots_ = nullptr;
+            size_type capacity_ = 0;
+            size_type size_ = 0;
+            size_type growth_left_ = 0;
+
+            template <typename K>
+            static auto hash_of(K const &key) -> std::uint64_t {
+                return value_flat_mix(value_flat_hash{}(key));
+            }
+
+            static auto h2_of(std::uint64_t h) -> value_flat_ctrl {
+                return static_cast<value_flat_ctrl>(h & 0x7F);
+            }
+
+            // The control array has value_flat_group_width - 1 trailing
+            // bytes which mirror the first bytes, so a group can be loaded
+            // at any slot without wrapping.
+            void set_ctrl(size_type i, value_flat_ctrl c) {
+                ctrl_[i] = c;
+                if (i < value_flat_group_width - 1)
+                    ctrl_[capacity_ + i] = c;
+            }
+
+            template <typename K>
+            auto find_index(K const &key) const -> size_type {
+                if (size_ == 0)
+                    return capacity_;
+                return find_index(key, hash_of(key));
+            }
+
+            template <typename K>
+            auto find_index(K const &key, std::uint64_t h) const
+                -> size_type {
+                if (capacity_ == 0)
+                    return capacity_;
+
+                auto mask = capacity_ - 1;
+                auto pos = (h >> 7) & mask;
+                auto h2 = h2_of(h);
+
+                for (size_type step = 0;;) {
+                    value_flat_group g{ctrl_ + pos};
+
+                    for (auto m = g.match(h2); m; m &= m - 1) {
+                        auto i = (pos + std::countr_zero(m)) & mask;
+                        if (value_flat_equal{}(Policy::key(slots_[i]), key))
+                            return i;
+                    }
+
+                    if (g.match_empty())
+                        return capacity_;
+
+                    step += value_flat_group_width;
+                    pos = (pos + step) & mask;
+                }
+            }
+
+            // Return the first empty or deleted slot on the probe sequence.
+            auto find_free(std::uint64_t h) const -> size_type {
+                auto mask = capacity_ - 1;
+                auto pos = (h >> 7) & mask;
+
+                for (size_type step = 0;;) {
+                    value_flat_group g{ctrl_ + pos};
+                    if (auto m = g.match_free())
+                        return (pos + std::countr_zero(m)) & mask;
+                    step += value_flat_group_width;
+                    pos = (pos + step) & mask;
+                }
+            }
+
+            // Claim a slot for a key known not to be in the table; the
+            // caller constructs the slot.
+            auto prepare_insert(std::uint64_t h) -> size_type {
+                if (growth_left_ == 0)
+                    grow();
+
+                auto i = find_free(h);
+                if (ctrl_[i] == value_flat_empty)
+                    --growth_left_;
+                set_ctrl(i, h2_of(h));
+                ++size_;
+                return i;
+            }
+
+            void erase_index(size_type i) {
+                slots_[i].~slot_type();
+                --size_;
+
+                // If the slot's group has never been full, no probe sequence
+                // can have passed through it, so it can go back to empty.
+                auto before = (i - value_flat_group_width) & (capacity_ - 1);
+                auto empty_after = value_flat_group{ctrl_ + i}.match_empty();
+                auto empty_before =
+                    value_flat_group{ctrl_ + before}.match_empty();
+                if (empty_before && empty_after &&
+                    std::countl_zero(empty_before << 16) +
+                            std::countr_zero(empty_after) <
+                        static_cast<int>(value_flat_group_width)) {
+                    set_ctrl(i, value_flat_empty);
+                    ++growth_left_;
+                } else {
+                    set_ctrl(i, value_flat_deleted);
+                }
+            }
+
+            void grow() {
+                if (capacity_ == 0)
+                    resize(value_flat_group_width);
+                else if (size_ * 32 <= capacity_ * 25)
+                    // Mostly tombstones: rehash in place at the same size.
+                    resize(capacity_);
+                else
+                    resize(capacity_ * 2);
+            }
+
+            void resize(size_type new_capacity) {
+                auto *old_ctrl = ctrl_;
+                auto *old_slots = slots_;
+                auto old_capacity = capacity_;
+
+                ctrl_ = new value_flat_ctrl[new_capacity +
+                                            value_flat_group_width - 1];
+                std::memset(ctrl_, value_flat_empty,
+                            new_capacity + value_flat_group_width - 1);
+                slots_ = std::allocator<slot_type>{}.allocate(new_capacity);
+                capacity_ = new_capacity;
+                growth_left_ = new_capacity - new_capacity / 8;
+                size_ = 0;
+
+                for (size_type i = 0; i < old_capacity; ++i) {
+                    if (old_ctrl[i] < 0)
+                        continue;
+                    auto &slot = old_slots[i];
+                    auto j = prepare_insert(hash_of(Policy::key(slot)));
+                    Policy::relocate(slot, slots_ + j);
+                    slot.~slot_type();
+                }
+
+                if (old_ctrl) {
+                    delete[] old_ctrl;
+                    std::allocator<slot_type>{}.deallocate(old_slots,
+                                                           old_capacity);
+                }
+            }
+
+            void destroy() {
+                if (!ctrl_)
+                    return;
+                for (size_type i = 0; i < capacity_; ++i)
+                    if (ctrl_[i] >= 0)
+                        slots_[i].~slot_type();
+                delete[] ctrl_;
+                std::allocator<slot_type>{}.deallocate(slots_, capacity_);
+            }
+        };
+
+        struct value_flat_set_policy {
+            using slot_type = value;
+            static constexpr bool keys_only = true;
+
+            static auto key(value const &v) -> value const & {
+                return v;
+            }
+
+            static void relocate(value &from, value *to) {
+                ::new (static_cast<void *>(to)) value(std::move(from));
+            }
+        };
+
+        template <typename V> struct value_flat_map_policy {
+            using slot_type = std::pair<value const, V>;
+            static constexpr bool keys_only = false;
+
+            static auto key(slot_type const &s) -> value const & {
+                return s.first;
+            }
+
+            // The old slot is destroyed straight after this, so moving out
+            // of its const key is safe and avoids a deep copy of the value.
+            static void relocate(slot_type &from, slot_type *to) {
+                ::new (static_cast<void *>(to)) slot_type(
+                    std::piecewise_construct,
+                    std::forward_as_tuple(
+                        std::move(const_cast<value &>(from.first))),
+                    std::forward_as_tuple(std::move(from.second)));
+            }
+        };
+
+        // Construct the stored key for a lookup key; string-like keys are
+        // stored as std::string, the same as sk::value{"..."} would.
+        template <typename K> auto value_flat_make_key(K &&key) -> value {
+            using key_type = std::remove_cvref_t<K>;
+            if constexpr (std::same_as<key_type, value>)
+                return value(std::forward<K>(key));
+            else if constexpr (std::same_as<key_type, nullptr_t>)
+                return value();
+            else if constexpr (std::convertible_to<K, std::string_view> &&
+                               !std::same_as<key_type, std::string>)
+                return value(std::string(std::string_view(key)));
+            else
+                return value(std::forward<K>(key));
+        }
+
+    } // namespace detail
+
+    /*
+     * A hash map from sk::value to V.
+     */
+    template <typename V>
+    class value_flat_map
+        : public detail::value_flat_table<detail::value_flat_map_policy<V>> {
+        using base =
+            detail::value_flat_table<detail::value_flat_map_policy<V>>;
+
+    public:
+        using key_type = value;
+        using mapped_type = V;
+        using value_type = std::pair<value const, V>;
+        using typename base::const_iterator;
+        using typename base::iterator;
+
+        // Insert key => V(args...) if the key is not present.
+        template <typename K, typename... Args>
+        auto try_emplace(K &&key, Args &&...args)
+            -> std::pair<iterator, bool> {
+            return this->find_or_insert(key, [&] {
+                return value_type(std::piecewise_construct,
+                                  std::forward_as_tuple(
+                                      detail::value_flat_make_key(
+                                          std::forward<K>(key))),
+                                  std::forward_as_tuple(
+                                      std::forward<Args>(args)...));
+            });
+        }
+
+        auto insert(value_type const &v) -> std::pair<iterator, bool> {
+            return try_emplace(v.first, v.second);
+        }
+
+        auto insert(value_type &&v) -> std::pair<iterator, bool> {
+            return try_emplace(v.first, std::move(v.second));
+        }
+
+        template <typename K, typename M>
+        auto insert_or_assign(K &&key, M &&m) -> std::pair<iterator, bool> {
+            auto r = try_emplace(std::forward<K>(key), std::forward<M>(m));
+            if (!r.second)
+                r.first->second = std::forward<M>(m);
+            return r;
+        }
+
+        template <typename K> auto operator[](K &&key) -> V & {
+            return try_emplace(std::forward<K>(key)).first->second;
+        }
+
+        template <typename K> auto at(K const &key) -> V & {
+            auto it = this->find(key);
+            if (it == this->end())
+                throw std::out_of_range("sk::value_flat_map::at");
+            return it->second;
+        }
+
+        template <typename K> auto at(K const &key) const -> V const & {
+            auto it = this->find(key);
+            if (it == this->end())
+                throw std::out_of_range("sk::value_flat_map::at");
+            return it->second;
+        }
+    };
+
+    /*
+     * A hash set of sk::value.
+     */
+    class value_flat_set
+        : public detail::value_flat_table<detail::value_flat_set_policy> {
+    public:
+        using key_type = value;
+        using value_type = value;
+
+        template <typename K>
+        auto insert(K &&key) -> std::pair<iterator, bool> {
+            return find_or_insert(key, [&] {
+                return detail::value_flat_make_key(std::forward<K>(key));
+            });
+        }
+    };
+
+} // namespace sk
+
+#endif // SK_VALUE_FLAT_MAP_HXX_INCLUDED
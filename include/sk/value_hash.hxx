@@ -0,0 +1,358 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef SK_VALUE_HASH_HXX_INCLUDED
+#define SK_VALUE_HASH_HXX_INCLUDED
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <string_view>
+#include <type_traits>
+
+#if (defined(__GNUC__) || defined(__clang__)) &&                               \
+    (defined(__x86_64__) || defined(__i386__))
+#    include <immintrin.h>
+#    define SK_VALUE_HASH_X86 1
+#endif
+
+#include "sk/value.hxx"
+
+/*
+ * hash_values - hash many values at once.
+ *
+ * hash_values(values, out) stores std::hash<sk::value>{}(values[i]) in
+ * out[i], but instead of calling each value's hash() it collects runs of
+ * values with the same type and hashes each run in one go:
+ *
+ *  - Integers hash to themselves, so a run is just widened.
+ *  - Doubles are hashed by a vector kernel (AVX2 or SSE4.2, chosen when
+ *    first used according to what the processor supports, with a scalar
+ *    fallback).
+ *  - Strings are hashed directly from their characters, including
+ *    borrowed strings, without a virtual call.
+ *
+ * Anything else is hashed one value at a time.  The results are always
+ * the same as std::hash: the kernels reproduce the standard library's hash
+ * functions, and are checked against them when first used and not used if
+ * they differ.
+ *
+ * hash_column() does the same for a column of plain objects, giving the
+ * hash each would have as an sk::value.
+ */
+
+namespace sk {
+
+    namespace detail {
+
+        /*
+         * Integers.  Every common standard library hashes integers no wider
+         * than std::size_t to their own value.
+         */
+        template <typename T>
+        inline constexpr bool value_hash_integer =
+            std::is_integral_v<T> && sizeof(T) <= sizeof(std::size_t);
+
+        template <typename T> auto value_hash_integer_is_identity() -> bool {
+            static bool const is_identity = [] {
+                using limits = std::numeric_limits<T>;
+                for (T v : {T(0), T(1), T(limits::max() / 3), limits::max(),
+                            limits::min()})
+                    if (std::hash<T>{}(v) != static_cast<std::size_t>(v))
+                        return false;
+                return true;
+            }();
+            return is_identity;
+        }
+
+        /*
+         * Doubles.  libstdc++ hashes a double (other than zero, which
+         * hashes to 0) with the 64-bit Murmur hash of its bytes; the kernels
+         * compute the same thing for several doubles at a time.
+         */
+        inline constexpr std::uint64_t value_hash_mul = 0xc6a4a7935bd1e995;
+        inline constexpr std::uint64_t value_hash_seed =
+            0xc70f6907 ^ (8 * value_hash_mul);
+
+        constexpr auto value_hash_shift_mix(std::uint64_t v) -> std::uint64_t {
+            return v ^ (v >> 47);
+        }
+
+        constexpr auto value_hash_double_bits(std::uint64_t bits)
+            -> std::uint64_t {
+            if ((bits << 1) == 0) // 0.0 or -0.0
+                return 0;
+            auto data = value_hash_shift_mix(bits * value_hash_mul) *
+                        value_hash_mul;
+            auto h = (value_hash_seed ^ data) * value_hash_mul;
+            return value_hash_shift_mix(value_hash_shift_mix(h) *
+                                        value_hash_mul);
+        }
+
+        using value_hash_double_kernel = void (*)(double const *,
+                                                  std::uint64_t *,
+                                                  std::size_t);
+
+        inline void value_hash_doubles_scalar(double const *in,
+                                              std::uint64_t *out,
+                                              std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i)
+                out[i] =
+                    value_hash_double_bits(std::bit_cast<std::uint64_t>(in[i]));
+        }
+
+        inline void value_hash_doubles_std(double const *in,
+                                           std::uint64_t *out, std::size_t n) {
+            for (std::size_t i = 0; i < n; ++i)
+                out[i] = std::hash<double>{}(in[i]);
+        }
+
+#ifdef SK_VALUE_HASH_X86
+        // 64-bit multiplication, which neither instruction set has, from
+        // 32-bit multiplications.
+        __attribute__((target("avx2"))) inline auto
+        value_hash_mul_avx2(__m256i a, __m256i b) -> __m256i {
+            auto lo = _mm256_mul_epu32(a, b);
+            auto cross = _mm256_add_epi64(
+                _mm256_mul_epu32(_mm256_srli_epi64(a, 32), b),
+                _mm256_mul_epu32(a, _mm256_srli_epi64(b, 32)));
+            return _mm256_add_epi64(lo, _mm256_slli_epi64(cross, 32));
+        }
+
+        __attribute__((target("avx2"))) inline auto
+        value_hash_shift_mix_avx2(__m256i v) -> __m256i {
+            return _mm256_xor_si256(v, _mm256_srli_epi64(v, 47));
+        }
+
+        __attribute__((target("avx2"))) inline void
+        value_hash_doubles_avx2(double const *in, std::uint64_t *out,
+                                std::size_t n) {
+            auto const mul =
+                _mm256_set1_epi64x(static_cast<long long>(value_hash_mul));
+            auto const seed =
+                _mm256_set1_epi64x(static_cast<long long>(value_hash_seed));
+            auto const zero = _mm256_setzero_si256();
+
+            std::size_t i = 0;
+            for (; i + 4 <= n; i += 4) {
+                auto bits = _mm256_loadu_si256(
+                    reinterpret_cast<__m256i const *>(in + i));
+                auto data = value_hash_mul_avx2(
+                    value_hash_shift_mix_avx2(value_hash_mul_avx2(bits, mul)),
+                    mul);
+                auto h =
+                    value_hash_mul_avx2(_mm256_xor_si256(seed, data), mul);
+                h = value_hash_shift_mix_avx2(value_hash_mul_avx2(
+                    value_hash_shift_mix_avx2(h), mul));
+                auto is_zero =
+                    _mm256_cmpeq_epi64(_mm256_slli_epi64(bits, 1), zero);
+                _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i),
+                                    _mm256_andnot_si256(is_zero, h));
+            }
+            value_hash_doubles_scalar(in + i, out + i, n - i);
+        }
+
+        __attribute__((target("sse4.2"))) inline auto
+        value_hash_mul_sse42(__m128i a, __m128i b) -> __m128i {
+            auto lo = _mm_mul_epu32(a, b);
+            auto cross =
+                _mm_add_epi64(_mm_mul_epu32(_mm_srli_epi64(a, 32), b),
+                              _mm_mul_epu32(a, _mm_srli_epi64(b, 32)));
+            return _mm_add_epi64(lo, _mm_slli_epi64(cross, 32));
+        }
+
+        __attribute__((target("sse4.2"))) inline auto
+        value_hash_shift_mix_sse42(__m128i v) -> __m128i {
+            return _mm_xor_si128(v, _mm_srli_epi64(v, 47));
+        }
+
+        __attribute__((target("sse4.2"))) inline void
+        value_hash_doubles_sse42(double const *in, std::uint64_t *out,
+                                 std::size_t n) {
+            auto const mul =
+                _mm_set1_epi64x(static_cast<long long>(value_hash_mul));
+            auto const seed =
+                _mm_set1_epi64x(static_cast<long long>(value_hash_seed));
+            auto const zero = _mm_setzero_si128();
+
+            std::size_t i = 0;
+            for (; i + 2 <= n; i += 2) {
+                auto bits =
+                    _mm_loadu_si128(reinterpret_cast<__m128i const *>(in + i));
+                auto data = value_hash_mul_sse42(
+                    value_hash_shift_mix_sse42(value_hash_mul_sse42(bits, mul)),
+                    mul);
+                auto h = value_hash_mul_sse42(_mm_xor_si128(seed, data), mul);
+                h = value_hash_shift_mix_sse42(value_hash_mul_sse42(
+                    value_hash_shift_mix_sse42(h), mul));
+                auto is_zero = _mm_cmpeq_epi64(_mm_slli_epi64(bits, 1), zero);
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i),
+                                 _mm_andnot_si128(is_zero, h));
+            }
+            value_hash_doubles_scalar(in + i, out + i, n - i);
+        }
+#endif
+
+        // Choose the kernel for doubles: the widest one the processor
+        // supports, provided the Murmur hash is what std::hash<double> uses.
+        inline auto value_hash_select_double_kernel()
+            -> value_hash_double_kernel {
+            for (double d : {1.0, -2.5, 1e300, 3.14159, -1e-300})
+                if (std::hash<double>{}(d) !=
+                    value_hash_double_bits(std::bit_cast<std::uint64_t>(d)))
+                    return value_hash_doubles_std;
+
+#ifdef SK_VALUE_HASH_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2"))
+                return value_hash_doubles_avx2;
+            if (__builtin_cpu_supports("sse4.2"))
+                return value_hash_doubles_sse42;
+#endif
+            return value_hash_doubles_scalar;
+        }
+
+        inline auto value_hash_double_kernel_for_cpu()
+            -> value_hash_double_kernel {
+            static value_hash_double_kernel const kernel =
+                value_hash_select_double_kernel();
+            return kernel;
+        }
+
+        inline void value_hash_check_sizes(std::size_t in, std::size_t out) {
+            if (in != out)
+                throw std::invalid_argument(
+                    "hash_values: output size does not match input size");
+        }
+
+    } // namespace detail
+
+    // Store in out[i] the hash that sk::value{column[i]} would have.
+    template <value_containable T>
+    void hash_column(std::span<T const> column, std::span<std::uint64_t> out) {
+        detail::value_hash_check_sizes(column.size(), out.size());
+
+        if constexpr (std::same_as<T, double>) {
+            detail::value_hash_double_kernel_for_cpu()(column.data(),
+                                                       out.data(),
+                                                       column.size());
+        } else if constexpr (detail::value_hash_integer<T>) {
+            if (detail::value_hash_integer_is_identity<T>()) {
+                for (std::size_t i = 0; i < column.size(); ++i)
+                    out[i] = static_cast<std::size_t>(column[i]);
+                return;
+            }
+            for (std::size_t i = 0; i < column.size(); ++i)
+                out[i] = std::hash<T>{}(column[i]);
+        } else {
+            for (std::size_t i = 0; i < column.size(); ++i)
+                out[i] = std::hash<T>{}(column[i]);
+        }
+    }
+
+    namespace detail {
+
+        // The number of objects collected from a run of values before they
+        // are hashed together.
+        inline constexpr std::size_t value_hash_batch = 64;
+
+        // Hash the run of values of type T starting at values[i], up to
+        // value_hash_batch of them, and return the index after the run.
+        template <typename T>
+        auto value_hash_run(std::span<value const> values,
+                            std::span<std::uint64_t> out, std::size_t i)
+            -> std::size_t {
+            T batch[value_hash_batch];
+            std::size_t n = 0;
+            for (; n < value_hash_batch && i + n < values.size(); ++n) {
+                auto const &v = values[i + n];
+                if (v.object->type_tag() != &value_type_tag<T>)
+                    break;
+                batch[n] = *value_cast<T>(&v);
+            }
+            hash_column(std::span<T const>(batch, n), out.subspan(i, n));
+            return i + n;
+        }
+
+        template <typename... Ts> struct value_hash_run_types {
+            // Hash the run starting at values[i] if its type is one of Ts.
+            static auto run(void const *tag, std::span<value const> values,
+                            std::span<std::uint64_t> out, std::size_t &i)
+                -> bool {
+                return ((tag == &value_type_tag<Ts> &&
+                         (i = value_hash_run<Ts>(values, out, i), true)) ||
+                        ...);
+            }
+        };
+
+        using value_hash_batched =
+            value_hash_run_types<double, int, unsigned, long, unsigned long,
+                                 long long, unsigned long long, short,
+                                 unsigned short, signed char, unsigned char,
+                                 char, bool>;
+
+    } // namespace detail
+
+    // Store std::hash<sk::value>{}(values[i]) in out[i].
+    inline void hash_values(std::span<value const> values,
+                            std::span<std::uint64_t> out) {
+        detail::value_hash_check_sizes(values.size(), out.size());
+
+        std::size_t i = 0;
+        while (i < values.size()) {
+            auto const &v = values[i];
+            auto const *tag = v.object->type_tag();
+
+            if (detail::value_hash_batched::run(tag, values, out, i))
+                continue;
+
+            if (tag == &value_type_tag<std::string>) {
+                auto start = i;
+                for (; i < values.size(); ++i) {
+                    auto s = value_string_view(values[i]);
+                    if (!s)
+                        break;
+                    out[i] = std::hash<std::string_view>{}(*s);
+                }
+                if (i != start)
+                    continue;
+            }
+
+            out[i] = std::hash<value>{}(v);
+            ++i;
+        }
+    }
+
+} // namespace sk
+
+#endif // SK_VALUE_HASH_HXX_INCLUDED
@@ -0,0 +1,485 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SK_VALUE_JSON_HXX_INCLUDED
+#define SK_VALUE_JSON_HXX_INCLUDED
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                    \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    include <emmintrin.h>
+#    define SK_VALUE_JSON_SSE2 1
+#endif
+
+#include "sk/value.hxx"
+
+/*
+ * write_json, parse_json - JSON encoding of scalar values and arrays of them.
+ *
+ * Values are written with their JSON type: empty values as null, bools as
+ * true or false, integers and floating point values as numbers, and strings
+ * as escaped strings.  Non-finite floating point values, which JSON cannot
+ * represent, are written as null, and finite ones always have a fraction or
+ * exponent ("1.0", not "1") so that they are read back as doubles.  Any
+ * other type is written as a string holding its str().
+ *
+ * parse_json() reads a scalar back, and parse_json_array() reads an array of
+ * scalars, without building a document tree.  Numbers without a fraction or
+ * exponent which fit in an std::int64_t become std::int64_t; other numbers
+ * become double.  Objects and nested arrays are rejected with
+ * value_format_error.
+ */
+
+namespace sk {
+
+    namespace detail {
+
+        inline auto value_json_needs_escape(unsigned char c) -> bool {
+            return c < 0x20 || c == '"' || c == '\\';
+        }
+
+        // The length of the prefix of s which needs no escaping; checks 16
+        // bytes at a time when SSE2 is available.
+        inline auto value_json_clean_prefix(std::string_view s)
+            -> std::size_t {
+            std::size_t i = 0;
+#ifdef SK_VALUE_JSON_SSE2
+            auto const quote = _mm_set1_epi8('"');
+            auto const backslash = _mm_set1_epi8('\\');
+            // Control characters are the bytes where (c ^ 0x80) < 0xA0 as
+            // a signed comparison, i.e. c < 0x20 unsigned.
+            auto const bias = _mm_set1_epi8(static_cast<char>(0x80));
+            auto const limit = _mm_set1_epi8(static_cast<char>(0x80 + 0x20));
+
+            for (; i + 16 <= s.size(); i += 16) {
+                auto chunk = _mm_loadu_si128(
+                    reinterpret_cast<__m128i const *>(s.data() + i));
+                auto bad = _mm_or_si128(
+                    _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                 _mm_cmpeq_epi8(chunk, backslash)),
+                    _mm_cmplt_epi8(_mm_xor_si128(chunk, bias), limit));
+                if (auto mask = _mm_movemask_epi8(bad))
+                    return i + static_cast<std::size_t>(std::countr_zero(
+                                   static_cast<unsigned>(mask)));
+            }
+#endif
+            while (i < s.size() &&
+                   !value_json_needs_escape(static_cast<unsigned char>(s[i])))
+                ++i;
+            return i;
+        }
+
+        inline void value_json_write_string(std::string_view s,
+                                            std::string &out) {
+            static constexpr char hex[] = "0123456789abcdef";
+
+            out.push_back('"');
+            while (!s.empty()) {
+                auto n = value_json_clean_prefix(s);
+                out.append(s.data(), n);
+                s.remove_prefix(n);
+                if (s.empty())
+                    break;
+
+                auto c = static_cast<unsigned char>(s.front());
+                s.remove_prefix(1);
+                switch (c) {
+                case '"':
+                    out.append("\\\"");
+                    break;
+                case '\\':
+                    out.append("\\\\");
+                    break;
+                case '\n':
+                    out.append("\\n");
+                    break;
+                case '\r':
+                    out.append("\\r");
+                    break;
+                case '\t':
+                    out.append("\\t");
+                    break;
+                case '\b':
+                    out.append("\\b");
+                    break;
+                case '\f':
+                    out.append("\\f");
+                    break;
+                default:
+                    out.append("\\u00");
+                    out.push_back(hex[c >> 4]);
+                    out.push_back(hex[c & 0xF]);
+                }
+            }
+            out.push_back('"');
+        }
+
+        template <typename T>
+        void value_json_write_number(T v, std::string &out) {
+            if constexpr (std::floating_point<T>) {
+                if (!std::isfinite(v)) {
+                    out.append("null");
+                    return;
+                }
+            }
+
+            char buf[64];
+            auto [p, ec] = std::to_chars(buf, buf + sizeof(buf), v);
+            out.append(buf, p);
+
+            if constexpr (std::floating_point<T>) {
+                if (std::find_if(buf, p, [](char c) {
+                        return c == '.' || c == 'e';
+                    }) == p)
+                    out.append(".0");
+            }
+        }
+
+        template <typename T>
+        auto value_json_write_as(value const &v, std::string &out) -> bool {
+            auto const *p = detail::value_probe<T>(&v);
+            if (!p)
+                return false;
+
+            if constexpr (std::same_as<T, bool>)
+                out.append(*p ? "true" : "false");
+            else
+                value_json_write_number(*p, out);
+            return true;
+        }
+
+        class value_json_parser {
+        public:
+            explicit value_json_parser(std::string_view text) : s(text) {}
+
+            auto scalar() -> value {
+                skip_ws();
+                if (s.empty())
+                    fail("unexpected end of input");
+
+                switch (s.front()) {
+                case 'n':
+                    literal("null");
+                    return value();
+                case 't':
+                    literal("true");
+                    return value(true);
+                case 'f':
+                    literal("false");
+                    return value(false);
+                case '"':
+                    return value(string());
+                case '[':
+                case '{':
+                    fail("expected a scalar");
+                }
+                return number();
+            }
+
+            void array(std::vector<value> &out) {
+                expect('[');
+                skip_ws();
+                if (!s.empty() && s.front() == ']') {
+                    s.remove_prefix(1);
+                    return;
+                }
+
+                for (;;) {
+                    out.push_back(scalar());
+                    skip_ws();
+                    if (s.empty())
+                        fail("unterminated array");
+                    char c = s.front();
+                    s.remove_prefix(1);
+                    if (c == ']')
+                        return;
+                    if (c != ',')
+                        fail("expected ',' or ']'");
+                }
+            }
+
+            void finish() {
+                skip_ws();
+                if (!s.empty())
+                    fail("trailing data");
+            }
+
+        private:
+            std::string_view s;
+
+            [[noreturn]] static void fail(char const *what) {
+                throw value_format_error(std::string("sk::parse_json: ") +
+                                         what);
+            }
+
+            void skip_ws() {
+                while (!s.empty() && (s.front() == ' ' || s.front() == '\t' ||
+                                      s.front() == '\n' || s.front() == '\r'))
+                    s.remove_prefix(1);
+            }
+
+            void expect(char c) {
+                skip_ws();
+                if (s.empty() || s.front() != c)
+                    fail("unexpected character");
+                s.remove_prefix(1);
+            }
+
+            void literal(std::string_view word) {
+                if (!s.starts_with(word))
+                    fail("invalid literal");
+                s.remove_prefix(word.size());
+            }
+
+            auto number() -> value {
+                // Find the extent of the number, and whether it is an
+                // integer, following the JSON grammar.
+                std::size_t i = 0;
+                bool integer = true;
+                if (i < s.size() && s[i] == '-')
+                    ++i;
+                auto digits = [&] {
+                    auto start = i;
+                    while (i < s.size() && s[i] >= '0' && s[i] <= '9')
+                        ++i;
+                    return i > start;
+                };
+                auto int_start = i;
+                if (!digits() || (s[int_start] == '0' && i - int_start > 1))
+                    fail("invalid number");
+                if (i < s.size() && s[i] == '.') {
+                    integer = false;
+                    ++i;
+                    if (!digits())
+                        fail("invalid number");
+                }
+                if (i < s.size() && (s[i] == 'e' || s[i] == 'E')) {
+                    integer = false;
+                    ++i;
+                    if (i < s.size() && (s[i] == '+' || s[i] == '-'))
+                        ++i;
+                    if (!digits())
+                        fail("invalid number");
+                }
+
+                auto const *first = s.data(), *last = s.data() + i;
+                s.remove_prefix(i);
+
+                if (integer) {
+                    std::int64_t n;
+                    auto [p, ec] = std::from_chars(first, last, n);
+                    if (ec == std::errc() && p == last)
+                        return value(n);
+                }
+
+                double d;
+                auto [p, ec] = std::from_chars(first, last, d);
+                if (ec != std::errc() || p != last)
+                    fail("invalid number");
+                return value(d);
+            }
+
+            auto hex4() -> std::uint32_t {
+                if (s.size() < 4)
+                    fail("invalid \\u escape");
+                std::uint32_t u = 0;
+                auto [p, ec] = std::from_chars(s.data(), s.data() + 4, u, 16);
+                if (ec != std::errc() || p != s.data() + 4)
+                    fail("invalid \\u escape");
+                s.remove_prefix(4);
+                return u;
+            }
+
+            static void put_utf8(std::uint32_t cp, std::string &out) {
+                if (cp < 0x80) {
+                    out.push_back(static_cast<char>(cp));
+                } else if (cp < 0x800) {
+                    out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+                    out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+                } else if (cp < 0x10000) {
+                    out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+                    out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+                    out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+                } else {
+                    out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+                    out.push_back(
+                        static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+                    out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+                    out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+                }
+            }
+
+            auto string() -> std::string {
+                s.remove_prefix(1);
+                std::string out;
+
+                for (;;) {
+                    // Copy unescaped runs in one go.
+                    auto n = value_json_clean_prefix(s);
+                    out.append(s.data(), n);
+                    s.remove_prefix(n);
+
+                    if (s.empty())
+                        fail("unterminated string");
+
+                    char c = s.front();
+                    s.remove_prefix(1);
+                    if (c == '"')
+                        return out;
+                    if (c != '\\')
+                        fail("control character in string");
+                    if (s.empty())
+                        fail("unterminated string");
+
+                    c = s.front();
+                    s.remove_prefix(1);
+                    switch (c) {
+                    case '"':
+                    case '\\':
+                    case '/':
+                        out.push_back(c);
+                        break;
+                    case 'b':
+                        out.push_back('\b');
+                        break;
+                    case 'f':
+                        out.push_back('\f');
+                        break;
+                    case 'n':
+                        out.push_back('\n');
+                        break;
+                    case 'r':
+                        out.push_back('\r');
+                        break;
+                    case 't':
+                        out.push_back('\t');
+                        break;
+                    case 'u': {
+                        auto cp = hex4();
+                        if (cp >= 0xD800 && cp < 0xDC00) {
+                            if (!s.starts_with("\\u"))
+                                fail("unpaired surrogate");
+                            s.remove_prefix(2);
+                            auto lo = hex4();
+                            if (lo < 0xDC00 || lo >= 0xE000)
+                                fail("unpaired surrogate");
+                            cp = 0x10000 + ((cp - 0xD800) << 10) +
+                                 (lo - 0xDC00);
+                        } else if (cp >= 0xDC00 && cp < 0xE000) {
+                            fail("unpaired surrogate");
+                        }
+                        put_utf8(cp, out);
+                        break;
+                    }
+                    default:
+                        fail("invalid escape");
+                    }
+                }
+            }
+        };
+
+    } // namespace detail
+
+    // Append the JSON representation of v to out.
+    inline void write_json(value const &v, std::string &out) {
+        if (v.empty()) {
+            out.append("null");
+            return;
+        }
+
+        if (auto s = value_string_view(v)) {
+            detail::value_json_write_string(*s, out);
+            return;
+        }
+
+        using namespace detail;
+        if (value_json_write_as<bool>(v, out) ||
+            value_json_write_as<int>(v, out) ||
+            value_json_write_as<std::int64_t>(v, out) ||
+            value_json_write_as<double>(v, out) ||
+            value_json_write_as<long>(v, out) ||
+            value_json_write_as<long long>(v, out) ||
+            value_json_write_as<unsigned int>(v, out) ||
+            value_json_write_as<unsigned long>(v, out) ||
+            value_json_write_as<unsigned long long>(v, out) ||
+            value_json_write_as<short>(v, out) ||
+            value_json_write_as<unsigned short>(v, out) ||
+            value_json_write_as<signed char>(v, out) ||
+            value_json_write_as<unsigned char>(v, out) ||
+            value_json_write_as<float>(v, out))
+            return;
+
+        value_json_write_string(v.str(), out);
+    }
+
+    // Append a JSON array of the values to out.
+    inline void write_json(std::span<value const> values, std::string &out) {
+        out.push_back('[');
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            if (i)
+                out.push_back(',');
+            write_json(values[i], out);
+        }
+        out.push_back(']');
+    }
+
+    inline auto to_json(value const &v) -> std::string {
+        std::string out;
+        write_json(v, out);
+        return out;
+    }
+
+    // Parse a JSON scalar.
+    inline auto parse_json(std::string_view text) -> value {
+        detail::value_json_parser p(text);
+        auto v = p.scalar();
+        p.finish();
+        return v;
+    }
+
+    // Parse a JSON array of scalars, appending the values to out.
+    inline void parse_json_array(std::string_view text,
+                                 std::vector<value> &out) {
+        detail::value_json_parser p(text);
+        p.array(out);
+        p.finish();
+    }
+
+} // namespace sk
+
+#endif // SK_VALUE_JSON_HXX_INCLUDED
@@ -0,0 +1,297 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SK_VALUE_KEY_HXX_INCLUDED
+#define SK_VALUE_KEY_HXX_INCLUDED
+
+#include <bit>
+#include <climits>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "sk/value.hxx"
+
+/*
+ * encode_key, decode_key - order-preserving binary keys.
+ *
+ * encode_key() turns a value, or a tuple of values, into a byte string whose
+ * lexicographic (memcmp) order is the same as the order of the values, so
+ * keys can be compared, sorted and prefix-compressed as plain bytes.
+ *
+ * Each value is encoded as a one-byte type tag followed by its payload:
+ *
+ *  - empty values have no payload, and sort before everything else;
+ *  - integers are stored big-endian with the sign bit flipped;
+ *  - floating point values are stored big-endian with the sign bit flipped
+ *    for positive numbers and all bits flipped for negative numbers, which
+ *    gives a total order (-0.0 sorts before +0.0, and NaNs sort at the ends);
+ *  - strings have each 0x00 byte escaped as 0x00 0xFF and are terminated by
+ *    0x00 0x01, so shorter strings sort before longer strings they prefix.
+ *
+ * Values of different types are ordered by their tag.  This order is fixed
+ * by the encoding, so it is stable across processes, but it is not the
+ * (implementation-defined) order operator< uses between different types.
+ *
+ * Each integer type is encoded with its own width, so keys are only portable
+ * between platforms which agree on the sizes of the integer types.
+ *
+ * Only the built-in types listed below can be encoded; encode_key() throws
+ * value_format_error for anything else, as decode_key() does for a key
+ * which is malformed.
+ */
+
+namespace sk {
+
+    namespace detail {
+
+        template <typename T> struct value_key_type;
+
+        // clang-format off
+        template <> struct value_key_type<nullptr_t>          { static constexpr unsigned char tag = 0x10; };
+        template <> struct value_key_type<bool>               { static constexpr unsigned char tag = 0x20; };
+        template <> struct value_key_type<char>               { static constexpr unsigned char tag = 0x21; };
+        template <> struct value_key_type<signed char>        { static constexpr unsigned char tag = 0x22; };
+        template <> struct value_key_type<short>              { static constexpr unsigned char tag = 0x23; };
+        template <> struct value_key_type<int>                { static constexpr unsigned char tag = 0x24; };
+        template <> struct value_key_type<long>               { static constexpr unsigned char tag = 0x25; };
+        template <> struct value_key_type<long long>          { static constexpr unsigned char tag = 0x26; };
+        template <> struct value_key_type<unsigned char>      { static constexpr unsigned char tag = 0x30; };
+        template <> struct value_key_type<unsigned short>     { static constexpr unsigned char tag = 0x31; };
+        template <> struct value_key_type<unsigned int>       { static constexpr unsigned char tag = 0x32; };
+        template <> struct value_key_type<unsigned long>      { static constexpr unsigned char tag = 0x33; };
+        template <> struct value_key_type<unsigned long long> { static constexpr unsigned char tag = 0x34; };
+        template <> struct value_key_type<float>              { static constexpr unsigned char tag = 0x40; };
+        template <> struct value_key_type<double>             { static constexpr unsigned char tag = 0x41; };
+        template <> struct value_key_type<std::string>        { static constexpr unsigned char tag = 0x50; };
+        // clang-format on
+
+        template <std::unsigned_integral U>
+        void value_key_put_uint(U u, std::string &out) {
+            for (int shift = sizeof(U) * CHAR_BIT - 8; shift >= 0; shift -= 8)
+                out.push_back(static_cast<char>((u >> shift) & 0xFF));
+        }
+
+        template <std::unsigned_integral U>
+        auto value_key_get_uint(std::string_view &in) -> U {
+            if (in.size() < sizeof(U))
+                throw value_format_error("sk::decode_key: truncated key");
+
+            U u = 0;
+            for (std::size_t i = 0; i < sizeof(U); ++i)
+                u = static_cast<U>((u << 8) |
+                                   static_cast<unsigned char>(in[i]));
+            in.remove_prefix(sizeof(U));
+            return u;
+        }
+
+        template <typename T>
+        using value_key_bits =
+            std::conditional_t<sizeof(T) == 4, std::uint32_t, std::uint64_t>;
+
+        template <typename T>
+        void value_key_put(T const &v, std::string &out) {
+            if constexpr (std::same_as<T, nullptr_t>) {
+                // No payload.
+            } else if constexpr (std::same_as<T, bool>) {
+                out.push_back(v ? 1 : 0);
+            } else if constexpr (std::integral<T>) {
+                using U = std::make_unsigned_t<T>;
+                auto u = static_cast<U>(v);
+                if constexpr (std::is_signed_v<T>)
+                    u ^= U(1) << (sizeof(U) * CHAR_BIT - 1);
+                value_key_put_uint(u, out);
+            } else if constexpr (std::floating_point<T>) {
+                using U = value_key_bits<T>;
+                auto u = std::bit_cast<U>(v);
+                constexpr auto sign = U(1) << (sizeof(U) * CHAR_BIT - 1);
+                u = (u & sign) ? ~u : (u | sign);
+                value_key_put_uint(u, out);
+            } else {
+                for (char c : v) {
+                    out.push_back(c);
+                    if (c == '\0')
+                        out.push_back('\xFF');
+                }
+                out.push_back('\0');
+                out.push_back('\x01');
+            }
+        }
+
+        template <typename T> auto value_key_get(std::string_view &in) -> T {
+            if constexpr (std::same_as<T, nullptr_t>) {
+                return nullptr;
+            } else if constexpr (std::same_as<T, bool>) {
+                return value_key_get_uint<unsigned char>(in) != 0;
+            } else if constexpr (std::integral<T>) {
+                using U = std::make_unsigned_t<T>;
+                auto u = value_key_get_uint<U>(in);
+                if constexpr (std::is_signed_v<T>)
+                    u ^= U(1) << (sizeof(U) * CHAR_BIT - 1);
+                return static_cast<T>(u);
+            } else if constexpr (std::floating_point<T>) {
+                using U = value_key_bits<T>;
+                auto u = value_key_get_uint<U>(in);
+                constexpr auto sign = U(1) << (sizeof(U) * CHAR_BIT - 1);
+                u = (u & sign) ? (u & ~sign) : ~u;
+                return std::bit_cast<T>(u);
+            } else {
+                std::string s;
+                for (std::size_t i = 0;; ++i) {
+                    if (i + 1 >= in.size())
+                        throw value_format_error(
+                            "sk::decode_key: unterminated string");
+
+                    if (in[i] != '\0') {
+                        s.push_back(in[i]);
+                        continue;
+                    }
+
+                    ++i;
+                    if (in[i] == '\x01') {
+                        in.remove_prefix(i + 1);
+                        return s;
+                    }
+                    if (in[i] != '\xFF')
+                        throw value_format_error(
+                            "sk::decode_key: invalid string escape");
+                    s.push_back('\0');
+                }
+            }
+        }
+
+        template <typename T>
+        auto value_key_encode_as(value const &v, std::string &out) -> bool {
+            if constexpr (std::same_as<T, nullptr_t>) {
+                if (!v.empty())
+                    return false;
+                out.push_back(static_cast<char>(value_key_type<T>::tag));
+                return true;
+            } else {
+                auto const *p = detail::value_probe<T>(&v);
+                if (!p)
+                    return false;
+                out.push_back(static_cast<char>(value_key_type<T>::tag));
+                value_key_put(*p, out);
+                return true;
+            }
+        }
+
+        template <typename T>
+        auto value_key_decode_as(unsigned char tag, std::string_view &in,
+                                 value &out) -> bool {
+            if (tag != value_key_type<T>::tag)
+                return false;
+            if constexpr (std::same_as<T, nullptr_t>)
+                out = value();
+            else
+                out = value(value_key_get<T>(in));
+            return true;
+        }
+
+        template <typename... Ts> struct value_key_codec {
+            static void encode(value const &v, std::string &out) {
+                if (!(value_key_encode_as<Ts>(v, out) || ...))
+                    throw value_format_error(
+                        "sk::encode_key: unsupported type");
+            }
+
+            static auto decode(std::string_view &in) -> value {
+                if (in.empty())
+                    throw value_format_error("sk::decode_key: truncated key");
+
+                auto tag = static_cast<unsigned char>(in.front());
+                in.remove_prefix(1);
+
+                value v;
+                if (!(value_key_decode_as<Ts>(tag, in, v) || ...))
+                    throw value_format_error("sk::decode_key: unknown tag");
+                return v;
+            }
+        };
+
+        using value_key_builtin_codec =
+            value_key_codec<nullptr_t, bool, char, signed char, short, int,
+                            long, long long, unsigned char, unsigned short,
+                            unsigned int, unsigned long, unsigned long long,
+                            float, double, std::string>;
+
+    } // namespace detail
+
+    // Append the key encoding of v to out.
+    inline void encode_key(value const &v, std::string &out) {
+        detail::value_key_builtin_codec::encode(v, out);
+    }
+
+    inline auto encode_key(value const &v) -> std::string {
+        std::string out;
+        encode_key(v, out);
+        return out;
+    }
+
+    // Encode a tuple of values; tuples compare element by element, and a
+    // tuple sorts before any longer tuple it is a prefix of.
+    inline void encode_key(std::span<value const> values, std::string &out) {
+        for (auto const &v : values)
+            encode_key(v, out);
+    }
+
+    inline auto encode_key(std::span<value const> values) -> std::string {
+        std::string out;
+        encode_key(values, out);
+        return out;
+    }
+
+    // Decode one value from the front of a key, removing it from the key.
+    inline auto decode_key_prefix(std::string_view &key) -> value {
+        return detail::value_key_builtin_codec::decode(key);
+    }
+
+    // Decode a key holding exactly one value.
+    inline auto decode_key(std::string_view key) -> value {
+        auto v = decode_key_prefix(key);
+        if (!key.empty())
+            throw value_format_error("sk::decode_key: trailing data");
+        return v;
+    }
+
+    // Decode a key holding a tuple of values.
+    inline auto decode_key_tuple(std::string_view key) -> std::vector<value> {
+        std::vector<value> values;
+        while (!key.empty())
+            values.push_back(decode_key_prefix(key));
+        return values;
+    }
+
+} // namespace sk
+
+#endif // SK_VALUE_KEY_HXX_INCLUDED
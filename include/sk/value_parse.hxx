@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SK_VALUE_PARSE_HXX_INCLUDED
+#define SK_VALUE_PARSE_HXX_INCLUDED
+
+#include <charconv>
+#include <cmath>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "sk/value.hxx"
+
+/*
+ * parse_value - convert text to the best-fitting value.
+ *
+ * A field is converted to the first of these which matches all of it:
+ *
+ *  - an empty value, if the text is options.null_text (by default, the
+ *    empty string);
+ *  - a bool, for "true" or "false" in any case;
+ *  - an std::int64_t, for a decimal integer which fits;
+ *  - a double, for a decimal or scientific floating point number;
+ *  - otherwise, an std::string holding the text.
+ *
+ * Numbers are parsed with std::from_chars, so they are locale-independent;
+ * a leading '+' is accepted.  Infinities and NaNs are never inferred, with
+ * or without a sign: "inf", "-inf", "nan" and "+nan" all become strings.
+ * Each kind of inference can be turned off in the options, in which case
+ * such fields become strings.
+ *
+ * parse_column() parses a whole column and picks one type for all of it:
+ * integers are widened to double if any field needs it, and if the fields
+ * do not agree on a type, the whole column is kept as strings.  Empty
+ * values are compatible with every type.
+ */
+
+namespace sk {
+
+    struct value_parse_options {
+        bool nulls = true;
+        bool bools = true;
+        bool integers = true;
+        bool floats = true;
+
+        // The text which represents an empty value.
+        std::string_view null_text = "";
+    };
+
+    // The kinds of value parse_value() produces, from most to least
+    // specific.
+    enum struct value_parse_kind {
+        empty,
+        boolean,
+        integer,
+        floating,
+        string,
+    };
+
+    namespace detail {
+
+        struct value_parse_result {
+            value_parse_kind kind;
+            union {
+                bool b;
+                std::int64_t i;
+                double d;
+            };
+        };
+
+        inline auto value_parse_iequals(std::string_view s, char const *word)
+            -> bool {
+            for (char c : s) {
+                if (*word == '\0')
+                    return false;
+                if ((c | 0x20) != *word++)
+                    return false;
+            }
+            return *word == '\0';
+        }
+
+        inline auto value_parse_classify(std::string_view s,
+                                         value_parse_options const &options)
+            -> value_parse_result {
+            value_parse_result r{value_parse_kind::string, {}};
+
+            if (options.nulls && s == options.null_text) {
+                r.kind = value_parse_kind::empty;
+                return r;
+            }
+
+            if (s.empty())
+                return r;
+
+            // Only look at text which can possibly be a number or a bool;
+            // most strings are rejected on their first character.
+            char c = s.front();
+            bool numeric = (c >= '0' && c <= '9') || c == '-' || c == '+' ||
+                           c == '.';
+
+            if (numeric) {
+                auto const *first = s.data(), *last = s.data() + s.size();
+                if (c == '+' && s.size() > 1 && s[1] != '-' && s[1] != '+')
+                    ++first;
+
+                if (options.integers) {
+                    auto [p, ec] = std::from_chars(first, last, r.i);
+                    if (ec == std::errc() && p == last) {
+                        r.kind = value_parse_kind::integer;
+                        return r;
+                    }
+                }
+
+                if (options.floats) {
+                    auto [p, ec] = std::from_chars(first, last, r.d);
+                    if (ec == std::errc() && p == last &&
+                        std::isfinite(r.d)) {
+                        r.kind = value_parse_kind::floating;
+                        return r;
+                    }
+                }
+
+                return r;
+            }
+
+            if (options.bools && (c | 0x20) == 't' &&
+                value_parse_iequals(s, "true")) {
+                r.kind = value_parse_kind::boolean;
+                r.b = true;
+            } else if (options.bools && (c | 0x20) == 'f' &&
+                       value_parse_iequals(s, "false")) {
+                r.kind = value_parse_kind::boolean;
+                r.b = false;
+            }
+
+            return r;
+        }
+
+        inline auto value_parse_make(value_parse_result const &r,
+                                     std::string_view s) -> value {
+            switch (r.kind) {
+            case value_parse_kind::empty:
+                return value();
+            case value_parse_kind::boolean:
+                return value(r.b);
+            case value_parse_kind::integer:
+                return value(r.i);
+            case value_parse_kind::floating:
+                return value(r.d);
+            case value_parse_kind::string:
+                break;
+            }
+            return value(std::string(s));
+        }
+
+    } // namespace detail
+
+    // Parse a single field.
+    inline auto parse_value(std::string_view s,
+                            value_parse_options const &options = {})
+        -> value {
+        return detail::value_parse_make(
+            detail::value_parse_classify(s, options), s);
+    }
+
+    // Parse a column of fields into values of a single type, appending them
+    // to out.  Returns the type chosen for the column; a column with no
+    // non-empty fields is value_parse_kind::empty.
+    inline auto parse_column(std::span<std::string_view const> fields,
+                             std::vector<value> &out,
+                             value_parse_options const &options = {})
+        -> value_parse_kind {
+        std::vector<detail::value_parse_result> parsed;
+        parsed.reserve(fields.size());
+
+        auto kind = value_parse_kind::empty;
+        for (auto field : fields) {
+            auto const &r = parsed.emplace_back(
+                detail::value_parse_classify(field, options));
+
+            if (r.kind == value_parse_kind::empty || r.kind == kind)
+                continue;
+
+            if (kind == value_parse_kind::empty)
+                kind = r.kind;
+            else if ((kind == value_parse_kind::integer &&
+                      r.kind == value_parse_kind::floating) ||
+                     (kind == value_parse_kind::floating &&
+                      r.kind == value_parse_kind::integer))
+                kind = value_parse_kind::floating;
+            else
+                kind = value_parse_kind::string;
+        }
+
+        out.reserve(out.size() + fields.size());
+        for (std::size_t i = 0; i < fields.size(); ++i) {
+            auto r = parsed[i];
+            if (r.kind == value_parse_kind::empty) {
+                out.emplace_back();
+                continue;
+            }
+
+            if (kind == value_parse_kind::floating &&
+                r.kind == value_parse_kind::integer) {
+                r.kind = value_parse_kind::floating;
+                r.d = static_cast<double>(r.i);
+            } else if (kind == value_parse_kind::string) {
+                r.kind = value_parse_kind::string;
+            }
+
+            out.push_back(detail::value_parse_make(r, fields[i]));
+        }
+
+        return kind;
+    }
+
+} // namespace sk
+
+#endif // SK_VALUE_PARSE_HXX_INCLUDED
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SK_VALUE_SORT_HXX_INCLUDED
+#define SK_VALUE_SORT_HXX_INCLUDED
+
+#include <algorithm>
+#include <cstddef>
+#include <span>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include "sk/value.hxx"
+
+/*
+ * sort_values - sort a span of values into the order given by operator<.
+ *
+ * operator< checks both values for emptiness, compares their types and then
+ * makes a virtual call to compare the objects.  sort_values() instead groups
+ * the values by type in a single pass (empty values first, then each type in
+ * the same order operator< uses), and then sorts each run of values of the
+ * same type using a comparator which knows the stored type statically.
+ * Types which are not in the built-in list below are sorted with a single
+ * virtual call per comparison.
+ *
+ * As with std::sort, the order of equivalent values is unspecified.
+ */
+
+namespace sk {
+
+    namespace detail {
+
+        // Return the object to compare by reference; only a run of strings,
+        // which may include borrowed strings, is compared as string_views.
+        template <typename T>
+        auto value_sort_object(value const &v) -> decltype(auto) {
+            if constexpr (std::same_as<T, std::string>)
+                return std::string_view{*value_string_view(v)};
+            else
+                return *value_cast<T>(&v);
+        }
+
+        // Sort a run of values if its type is T.
+        template <typename T>
+        auto value_sort_run_as(std::span<value> run, std::type_info const &type)
+            -> bool {
+            if (type != typeid(value_instance<T>))
+                return false;
+
+            std::sort(run.begin(), run.end(),
+                      [](value const &a, value const &b) {
+                          return value_lt_compare(value_sort_object<T>(a),
+                                                  value_sort_object<T>(b));
+                      });
+            return true;
+        }
+
+        template <typename... Ts>
+        void value_sort_run(std::span<value> run, std::type_info const &type) {
+            if ((value_sort_run_as<Ts>(run, type) || ...))
+                return;
+
+            std::sort(run.begin(), run.end(),
+                      [](value const &a, value const &b) {
+                          return a.object->lt(b.object.get());
+                      });
+        }
+
+    } // namespace detail
+
+    inline void sort_values(std::span<value> values) {
+        auto const n = values.size();
+        if (n < 2)
+            return;
+
+        // The distinct types present, and the type of each value as an
+        // index into that list.
+        std::vector<std::type_info const *> types;
+        std::vector<std::size_t> type_of(n);
+
+        for (std::size_t i = 0; i < n; ++i) {
+            auto const &t = values[i].object->type();
+            auto it = std::find_if(types.begin(), types.end(),
+                                   [&](auto const *p) { return *p == t; });
+            type_of[i] = static_cast<std::size_t>(it - types.begin());
+            if (it == types.end())
+                types.push_back(&t);
+        }
+
+        // Order the types as operator< does: empty first, then by
+        // type_info::before().
+        auto const &empty_type = typeid(value_instance<nullptr_t>);
+        std::vector<std::size_t> rank(types.size());
+        {
+            std::vector<std::size_t> order(types.size());
+            for (std::size_t i = 0; i < order.size(); ++i)
+                order[i] = i;
+            std::sort(order.begin(), order.end(),
+                      [&](std::size_t a, std::size_t b) {
+                          auto const &ta = *types[a], &tb = *types[b];
+                          if (tb == empty_type)
+                              return false;
+                          if (ta == empty_type)
+                              return true;
+                          return ta.before(tb);
+                      });
+            for (std::size_t i = 0; i < order.size(); ++i)
+                rank[order[i]] = i;
+        }
+
+        // Counting sort by type rank.  Moving a value only moves its
+        // pointer, so this is cheap.
+        std::vector<std::size_t> start(types.size() + 1);
+        for (std::size_t i = 0; i < n; ++i)
+            ++start[rank[type_of[i]] + 1];
+        for (std::size_t r = 1; r < start.size(); ++r)
+            start[r] += start[r - 1];
+
+        if (types.size() > 1) {
+            std::vector<std::size_t> position(start.begin(), start.end() - 1);
+            std::vector<value> sorted;
+            sorted.reserve(n);
+            std::vector<value *> slot(n);
+            for (std::size_t i = 0; i < n; ++i)
+                slot[position[rank[type_of[i]]]++] = &values[i];
+            for (auto *v : slot)
+                sorted.push_back(std::move(*v));
+            std::move(sorted.begin(), sorted.end(), values.begin());
+        }
+
+        // Sort each run with a comparator for its type.  Empty values are
+        // all equivalent, so that run is already sorted.
+        for (std::size_t t = 0; t < types.size(); ++t) {
+            auto const &type = *types[t];
+            if (type == empty_type)
+                continue;
+
+            auto run = values.subspan(start[rank[t]], start[rank[t] + 1] -
+                                                          start[rank[t]]);
+            detail::value_sort_run<
+                bool, char, signed char, unsigned char, wchar_t, char8_t,
+                char16_t, char32_t, short, unsigned short, int, unsigned int,
+                long, unsigned long, long long, unsigned long long, float,
+                double, long double, std::string, std::wstring,
+                std::u8string, std::u16string, std::u32string>(run, type);
+        }
+    }
+
+} // namespace sk
+
+#endif // SK_VALUE_SORT_HXX_INCLUDED
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef SK_VALUE_STATS_HXX_INCLUDED
+#define SK_VALUE_STATS_HXX_INCLUDED
+
+#include <cstdint>
+#include <map>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+
+/*
+ * value_stats - per-thread counters of what values are doing.
+ *
+ * Counting is enabled by defining SK_VALUE_STATS before sk/value.hxx is
+ * included, and must be enabled the same way in every translation unit of
+ * a program.  Without it the counting hooks expand to nothing, and the
+ * functions below report zeros.
+ *
+ * Counters are kept per thread and per stored type, identified by the
+ * instance type as reported by value_base::type() (for example
+ * typeid(sk::value_instance<int>)).  A typical use is to reset the counters
+ * at the start of a request and take a snapshot at the end.
+ *
+ * failed_casts counts only calls to value_cast which fail.  The library
+ * probes a value's type internally (when writing JSON or encoding a key,
+ * for example), and those probes are not counted.
+ */
+
+namespace sk {
+
+    struct value_stats {
+        std::uint64_t constructions = 0; // sk::value objects created
+        std::uint64_t allocations = 0;   // stored objects allocated
+        std::uint64_t copies = 0;        // deep copies of values
+        std::uint64_t moves = 0;
+        std::uint64_t comparisons = 0; // == and <
+        std::uint64_t hashes = 0;
+        std::uint64_t string_conversions = 0; // calls to str()
+        std::uint64_t failed_casts = 0;       // value_cast to the wrong type
+
+        auto operator+=(value_stats const &o) -> value_stats & {
+            constructions += o.constructions;
+            allocations += o.allocations;
+            copies += o.copies;
+            moves += o.moves;
+            comparisons += o.comparisons;
+            hashes += o.hashes;
+            string_conversions += o.string_conversions;
+            failed_casts += o.failed_casts;
+            return *this;
+        }
+
+        auto operator==(value_stats const &) const -> bool = default;
+    };
+
+    struct value_stats_report {
+        value_stats total;
+        std::map<std::type_index, value_stats> by_type;
+    };
+
+    namespace detail {
+
+        struct value_stats_thread {
+            std::unordered_map<std::type_info const *, value_stats> by_type;
+            // The most recently counted type, which is usually the next.
+            std::type_info const *last_type = nullptr;
+            value_stats *last = nullptr;
+        };
+
+        inline auto value_stats_local() -> value_stats_thread & {
+            thread_local value_stats_thread stats;
+            return stats;
+        }
+
+        inline void value_stats_count(std::uint64_t value_stats::*counter,
+                                      std::type_info const &type) {
+            auto &local = value_stats_local();
+            if (local.last_type != &type) {
+                local.last = &local.by_type[&type];
+                local.last_type = &type;
+            }
+            ++(local.last->*counter);
+        }
+
+        // Count against the type stored in a value_base, or against void
+        // for a value which has been moved from.
+        template <typename Object>
+        void value_stats_count(std::uint64_t value_stats::*counter,
+                               Object const *object) {
+            value_stats_count(counter, object ? object->type() : typeid(void));
+        }
+
+    } // namespace detail
+
+    // The counters for this thread since the last reset.
+    inline auto value_stats_snapshot() -> value_stats_report {
+        value_stats_report report;
+        for (auto const &[type, stats] : detail::value_stats_local().by_type) {
+            report.by_type[std::type_index(*type)] += stats;
+            report.total += stats;
+        }
+        return report;
+    }
+
+    // Reset the counters for this thread.
+    inline void value_stats_reset() {
+        auto &local = detail::value_stats_local();
+        local.by_type.clear();
+        local.last_type = nullptr;
+        local.last = nullptr;
+    }
+
+} // namespace sk
+
+#endif // SK_VALUE_STATS_HXX_INCLUDED
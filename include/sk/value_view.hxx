@@ -0,0 +1,490 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SK_VALUE_VIEW_HXX_INCLUDED
+#define SK_VALUE_VIEW_HXX_INCLUDED
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+#include "sk/value.hxx"
+#include "sk/value_binary.hxx"
+
+/*
+ * value_view - a value read in place from the binary format written by
+ * value_writer.
+ *
+ * A value_view refers to the encoded bytes, which must outlive it; it never
+ * allocates.  It can be compared with other views and with values, hashed
+ * (with the same result as std::hash<sk::value> on the decoded value) and
+ * printed, and its object can be read directly, with strings returned as a
+ * std::string_view into the buffer.  materialize() creates an owning
+ * sk::value when one is needed.
+ *
+ * value_view_cursor iterates the values in a whole stream, such as a file
+ * mapped into memory, with batches flattened into their values.
+ *
+ * User types have no in-place representation, so comparing, hashing or
+ * printing one decodes it through the registry first.
+ */
+
+namespace sk {
+
+    namespace detail {
+
+        template <typename... Ts> struct value_view_types {};
+
+        // The types value_view reads in place, including empty.
+        using value_view_builtin_types =
+            value_view_types<nullptr_t, bool, char, signed char, short, int,
+                             long, long long, unsigned char, unsigned short,
+                             unsigned int, unsigned long, unsigned long long,
+                             float, double, std::string>;
+
+    } // namespace detail
+
+    // The type value_view::get<T>() returns: a view for strings, the object
+    // itself otherwise.
+    template <typename T>
+    using value_view_result =
+        std::conditional_t<std::same_as<T, std::string>, std::string_view, T>;
+
+    class value_view {
+    public:
+        // A view of an empty value.
+        value_view() = default;
+
+        // Parse one value from the front of the buffer, and advance the
+        // buffer past it.  A batch header is not a value; use
+        // value_view_cursor to read streams containing batches.
+        static auto parse(std::span<std::byte const> &buffer) -> value_view {
+            auto const *p = buffer.data(), *end = p + buffer.size();
+            if (p == end)
+                throw value_format_error("sk::value_view: truncated value");
+
+            value_view v;
+            v.tag = static_cast<unsigned char>(*p++);
+
+            switch (v.tag) {
+            case detail::value_tag_empty:
+            case detail::value_tag_false:
+            case detail::value_tag_true:
+                break;
+
+            case detail::value_tag_user: {
+                auto id = detail::value_binary_varint(p, end);
+                if (id > UINT32_MAX)
+                    throw value_format_error("sk::value_view: invalid type id");
+                v.bits = id;
+                p = v.take_bytes(p, end);
+                break;
+            }
+
+            default:
+                if (!parse_builtin(v, p, end,
+                                   detail::value_view_builtin_types{}))
+                    throw value_format_error("sk::value_view: unknown tag");
+            }
+
+            v.encoding = {buffer.data(), static_cast<std::size_t>(
+                                             p - buffer.data())};
+            buffer = buffer.subspan(v.encoding.size());
+            return v;
+        }
+
+        // Parse a buffer holding exactly one encoded value.
+        explicit value_view(std::span<std::byte const> buffer) {
+            *this = parse(buffer);
+            if (!buffer.empty())
+                throw value_format_error("sk::value_view: trailing data");
+        }
+
+        // The bytes of the encoded value, including its tag.
+        auto encoded() const -> std::span<std::byte const> {
+            return encoding;
+        }
+
+        auto empty() const -> bool {
+            return tag == detail::value_tag_empty;
+        }
+
+        // The type operator< uses to order values of different types; the
+        // same as v.object->type() for the decoded value.
+        auto type() const -> std::type_info const & {
+            std::type_info const *t = nullptr;
+            visit([&]<typename T>(T const *) {
+                t = &typeid(value_instance<T>);
+            });
+            return t ? *t : *user_entry()->type;
+        }
+
+        // The stored object, or nothing if the value is not a T.
+        template <value_containable T>
+        auto get_if() const -> std::optional<value_view_result<T>> {
+            std::optional<value_view_result<T>> r;
+            if constexpr (tag_of<T>() == no_tag) {
+                if (tag == detail::value_tag_user) {
+                    auto v = materialize();
+                    if (auto const *p = detail::value_probe<T>(&v))
+                        r = *p;
+                }
+            } else if (is<T>()) {
+                r = object<T>();
+            }
+            return r;
+        }
+
+        // The stored object; throws std::bad_cast if the value is not a T.
+        template <value_containable T>
+        auto get() const -> value_view_result<T> {
+            auto r = get_if<T>();
+            if (!r)
+                throw std::bad_cast();
+            return *r;
+        }
+
+        // Create an owning value.
+        auto materialize() const -> value {
+            value v;
+            if (visit([&]<typename T>(T const *) {
+                    if constexpr (std::same_as<T, std::string>)
+                        v = std::string(object<T>());
+                    else if constexpr (!std::same_as<T, nullptr_t>)
+                        v = object<T>();
+                }))
+                return v;
+            return user_entry()->decode(bytes);
+        }
+
+        auto str() const -> std::string {
+            std::string s;
+            if (visit([&]<typename T>(T const *) {
+                    if constexpr (std::same_as<T, std::string>)
+                        s = object<T>();
+                    else
+                        s = value_containable_to_string(object<T>());
+                }))
+                return s;
+            return materialize().str();
+        }
+
+        auto hash() const -> std::size_t {
+            std::size_t h = 0;
+            if (visit([&]<typename T>(T const *) {
+                    h = std::hash<value_view_result<T>>{}(object<T>());
+                }))
+                return h;
+            return std::hash<value>{}(materialize());
+        }
+
+        friend auto operator==(value_view const &a, value_view const &b)
+            -> bool {
+            if (a.empty() || b.empty())
+                return a.empty() && b.empty();
+            if (a.tag != b.tag)
+                return false;
+
+            bool r = false;
+            if (a.visit([&]<typename T>(T const *) {
+                    r = a.object<T>() == b.object<T>();
+                }))
+                return r;
+            return a.materialize() == b.materialize();
+        }
+
+        friend auto operator==(value_view const &a, value const &b) -> bool {
+            if (a.empty() || b.empty())
+                return a.empty() && b.empty();
+
+            bool r = false;
+            if (a.visit([&]<typename T>(T const *) {
+                    if constexpr (std::same_as<T, std::string>) {
+                        auto s = value_string_view(b);
+                        r = s && a.object<T>() == *s;
+                    } else {
+                        auto const *p = detail::value_probe<T>(&b);
+                        r = p && a.object<T>() == *p;
+                    }
+                }))
+                return r;
+            return a.materialize() == b;
+        }
+
+        friend auto operator<(value_view const &a, value_view const &b)
+            -> bool {
+            if (a.empty() || b.empty())
+                return a.empty() && !b.empty();
+            // true and false have different tags but the same type.
+            auto const &at = a.type(), &bt = b.type();
+            if (at != bt)
+                return at.before(bt);
+
+            bool r = false;
+            if (a.visit([&]<typename T>(T const *) {
+                    if constexpr (!std::same_as<T, nullptr_t>)
+                        r = a.object<T>() < b.object<T>();
+                }))
+                return r;
+            return a.materialize() < b.materialize();
+        }
+
+        friend auto operator<(value_view const &a, value const &b) -> bool {
+            if (a.empty() || b.empty())
+                return a.empty() && !b.empty();
+
+            auto const &at = a.type(), &bt = b.object->type();
+            if (at != bt)
+                return at.before(bt);
+
+            bool r = false;
+            if (a.visit([&]<typename T>(T const *) {
+                    if constexpr (!std::same_as<T, nullptr_t>)
+                        r = a.object<T>() < object_of<T>(b);
+                }))
+                return r;
+            return a.materialize() < b;
+        }
+
+        friend auto operator<(value const &a, value_view const &b) -> bool {
+            if (a.empty() || b.empty())
+                return a.empty() && !b.empty();
+
+            auto const &at = a.object->type(), &bt = b.type();
+            if (at != bt)
+                return at.before(bt);
+
+            bool r = false;
+            if (b.visit([&]<typename T>(T const *) {
+                    if constexpr (!std::same_as<T, nullptr_t>)
+                        r = object_of<T>(a) < b.object<T>();
+                }))
+                return r;
+            return a < b.materialize();
+        }
+
+    private:
+        unsigned char tag = detail::value_tag_empty;
+        // Integers (zigzag-decoded for signed types), the bits of floating
+        // point values, or a user type's id.
+        std::uint64_t bits = 0;
+        // A string's contents or a user type's payload.
+        std::string_view bytes;
+        std::span<std::byte const> encoding;
+
+        static constexpr int no_tag = -1;
+
+        // The tag for T, other than bool and empty which have their own.
+        template <typename T> static constexpr auto tag_of() -> int {
+            if constexpr (std::same_as<T, bool> ||
+                          std::same_as<T, nullptr_t>)
+                return detail::value_tag_true;
+            else if constexpr (requires { detail::value_binary_type<T>::tag; })
+                return detail::value_binary_type<T>::tag;
+            else
+                return no_tag;
+        }
+
+        template <typename T> auto is() const -> bool {
+            if constexpr (std::same_as<T, bool>)
+                return tag == detail::value_tag_true ||
+                       tag == detail::value_tag_false;
+            else if constexpr (std::same_as<T, nullptr_t>)
+                return tag == detail::value_tag_empty;
+            else
+                return tag == tag_of<T>();
+        }
+
+        // Call f(static_cast<T const *>(nullptr)) with the stored type, if
+        // it is a built-in type or empty; returns false for user types.
+        template <typename F> auto visit(F &&f) const -> bool {
+            return visit_as(f, detail::value_view_builtin_types{});
+        }
+
+        template <typename F, typename... Ts>
+        auto visit_as(F &f, detail::value_view_types<Ts...>) const -> bool {
+            return ((is<Ts>() ? (f(static_cast<Ts const *>(nullptr)), true)
+                              : false) ||
+                    ...);
+        }
+
+        template <typename T> auto object() const -> value_view_result<T> {
+            if constexpr (std::same_as<T, nullptr_t>)
+                return nullptr;
+            else if constexpr (std::same_as<T, bool>)
+                return tag == detail::value_tag_true;
+            else if constexpr (std::same_as<T, std::string>)
+                return bytes;
+            else if constexpr (std::same_as<T, float>)
+                return std::bit_cast<float>(static_cast<std::uint32_t>(bits));
+            else if constexpr (std::same_as<T, double>)
+                return std::bit_cast<double>(bits);
+            else
+                return static_cast<T>(bits);
+        }
+
+        // The object in a value already known to hold a T, with strings
+        // as views.
+        template <typename T>
+        static auto object_of(value const &v) -> value_view_result<T> {
+            if constexpr (std::same_as<T, std::string>)
+                return *value_string_view(v);
+            else
+                return value_cast<T>(v);
+        }
+
+        auto take_bytes(std::byte const *p, std::byte const *end)
+            -> std::byte const * {
+            auto n = detail::value_binary_varint(p, end);
+            if (n > static_cast<std::uint64_t>(end - p))
+                throw value_format_error("sk::value_view: truncated value");
+            bytes = {reinterpret_cast<char const *>(p),
+                     static_cast<std::size_t>(n)};
+            return p + n;
+        }
+
+        template <typename T>
+        static auto parse_one(value_view &v, std::byte const *&p,
+                              std::byte const *end) -> bool {
+            // Empty and bool values have no payload.
+            if constexpr (std::same_as<T, bool> ||
+                          std::same_as<T, nullptr_t>) {
+                return false;
+            } else if (v.tag != tag_of<T>()) {
+                return false;
+            } else if constexpr (std::same_as<T, char>) {
+                if (p == end)
+                    throw value_format_error(
+                        "sk::value_view: truncated value");
+                v.bits = static_cast<std::uint64_t>(*p++);
+            } else if constexpr (std::integral<T>) {
+                auto u = detail::value_binary_varint(p, end);
+                bool ok;
+                if constexpr (std::is_signed_v<T>) {
+                    auto i = detail::value_unzigzag(u);
+                    ok = std::in_range<T>(i);
+                    u = static_cast<std::uint64_t>(i);
+                } else {
+                    ok = std::in_range<T>(u);
+                }
+                if (!ok)
+                    throw value_format_error(
+                        "sk::value_view: integer out of range");
+                v.bits = u;
+            } else if constexpr (std::floating_point<T>) {
+                if (static_cast<std::size_t>(end - p) < sizeof(T))
+                    throw value_format_error(
+                        "sk::value_view: truncated value");
+                for (std::size_t i = 0; i < sizeof(T); ++i)
+                    v.bits |= static_cast<std::uint64_t>(
+                                  static_cast<unsigned char>(p[i]))
+                              << (i * 8);
+                p += sizeof(T);
+            } else {
+                p = v.take_bytes(p, end);
+            }
+            return true;
+        }
+
+        template <typename... Ts>
+        static auto parse_builtin(value_view &v, std::byte const *&p,
+                                  std::byte const *end,
+                                  detail::value_view_types<Ts...>) -> bool {
+            return (parse_one<Ts>(v, p, end) || ...);
+        }
+
+        auto user_entry() const
+            -> std::shared_ptr<value_type_registry::entry const> {
+            auto e = value_type_registry::global().find(
+                static_cast<std::uint32_t>(bits));
+            if (!e)
+                throw value_format_error(
+                    "sk::value_view: type is not registered");
+            return e;
+        }
+    };
+
+    inline auto operator<<(std::ostream &strm, value_view const &v)
+        -> std::ostream & {
+        return strm << v.str();
+    }
+
+    /*
+     * Iterate the values in a stream written by value_writer.
+     */
+    class value_view_cursor {
+    public:
+        explicit value_view_cursor(std::span<std::byte const> stream)
+            : rest(stream) {
+            auto const &magic = detail::value_binary_magic;
+            if (rest.size() < sizeof(magic) ||
+                std::memcmp(rest.data(), magic, sizeof(magic) - 1) != 0)
+                throw value_format_error("sk::value_view_cursor: bad magic");
+            if (rest[3] != magic[3])
+                throw value_format_error(
+                    "sk::value_view_cursor: unsupported version");
+            rest = rest.subspan(sizeof(magic));
+        }
+
+        // Read the next value; returns false at the end of the stream.
+        auto next(value_view &v) -> bool {
+            while (!rest.empty() &&
+                   rest.front() == std::byte{detail::value_tag_batch}) {
+                auto const *p = rest.data() + 1, *end = p + rest.size() - 1;
+                detail::value_binary_varint(p, end);
+                rest = rest.subspan(static_cast<std::size_t>(p - rest.data()));
+            }
+
+            if (rest.empty())
+                return false;
+            v = value_view::parse(rest);
+            return true;
+        }
+
+    private:
+        std::span<std::byte const> rest;
+    };
+
+} // namespace sk
+
+template <> struct std::hash<sk::value_view> {
+    auto operator()(sk::value_view const &v) const -> std::size_t {
+        return v.hash();
+    }
+};
+
+#endif // SK_VALUE_VIEW_HXX_INCLUDED
@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef SK_VALUE_VISIT_HXX_INCLUDED
+#define SK_VALUE_VISIT_HXX_INCLUDED
+
+#include <concepts>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+
+#include "sk/value.hxx"
+
+/*
+ * visit - call a function with a value's object as its concrete type.
+ *
+ *   using types = sk::value_types<int, double, std::string_view>;
+ *   sk::visit<types>(v, overloaded{
+ *       [](int i) { ... },
+ *       [](double d) { ... },
+ *       [](std::string_view s) { ... },
+ *       [](std::monostate) { ... },        // empty value
+ *       [](sk::value const &v) { ... },    // any other type
+ *   });
+ *
+ * The value's type tag is looked up in the type list and the visitor is
+ * called through a table of functions indexed by its position, so each
+ * visit costs one virtual call, a short scan of the tags and one indirect
+ * call, rather than a cast per candidate type.
+ *
+ * The visitor must accept sk::value const &, which is used for types not in
+ * the list, and whose return type is the return type of visit().  Empty
+ * values are passed as std::monostate if the visitor accepts it, and
+ * otherwise also go to the sk::value const & case.  Listing
+ * std::string_view matches both owned and borrowed strings without copying
+ * them; listing std::string passes a std::string, making an owned copy of a
+ * borrowed string.
+ */
+
+namespace sk {
+
+    template <typename... Ts> struct value_types {};
+
+    namespace detail {
+
+        template <typename T>
+        inline constexpr void const *value_visit_tag = &value_type_tag<T>;
+
+        template <>
+        inline constexpr void const *value_visit_tag<std::string_view> =
+            &value_type_tag<std::string>;
+
+        template <typename R, typename Visitor, typename T>
+        auto value_visit_one(value const &v, Visitor &vis) -> R {
+            if constexpr (std::same_as<T, std::string_view>)
+                return vis(*value_string_view(v));
+            else if constexpr (std::same_as<T, std::string>)
+                return vis(value_cast<std::string>(v));
+            else
+                return vis(*value_cast<T>(&v));
+        }
+
+        template <typename R, typename Visitor>
+        auto value_visit_empty(value const &v, Visitor &vis) -> R {
+            if constexpr (std::invocable<Visitor &, std::monostate>)
+                return vis(std::monostate{});
+            else
+                return vis(v);
+        }
+
+        template <typename R, typename Visitor>
+        auto value_visit_other(value const &v, Visitor &vis) -> R {
+            return vis(v);
+        }
+
+        template <typename List> struct value_visit_dispatch;
+
+        template <typename... Ts>
+        struct value_visit_dispatch<value_types<Ts...>> {
+            static constexpr void const *tags[] = {
+                &value_type_tag<std::nullptr_t>, value_visit_tag<Ts>...};
+
+            template <typename Visitor>
+            static auto call(value const &v, Visitor &vis) -> decltype(auto) {
+                using R = std::invoke_result_t<Visitor &, value const &>;
+                using entry = R (*)(value const &, Visitor &);
+
+                // The tag's position in tags[] is its index in this table;
+                // one past the end is for types not in the list.
+                static constexpr entry table[] = {
+                    &value_visit_empty<R, Visitor>,
+                    &value_visit_one<R, Visitor, Ts>...,
+                    &value_visit_other<R, Visitor>};
+
+                auto const *tag = v.object->type_tag();
+                std::size_t i = 0;
+                while (i < std::size(tags) && tags[i] != tag)
+                    ++i;
+                return table[i](v, vis);
+            }
+        };
+
+    } // namespace detail
+
+    template <typename List, typename Visitor>
+    auto visit(value const &v, Visitor &&vis) -> decltype(auto) {
+        return detail::value_visit_dispatch<List>::call(v, vis);
+    }
+
+} // namespace sk
+
+#endif // SK_VALUE_VISIT_HXX_INCLUDED
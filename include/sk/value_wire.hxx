@@ -0,0 +1,632 @@
+/*
+ * Copyright (c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license (the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third-parties to whom the Software is furnished to
+ * do so, all subject to the following:
+ *
+ * The copyright notices in the Software and this entire statement, including
+ * the above license grant, this restriction and the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine-executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON-INFRINGEMENT. IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef SK_VALUE_WIRE_HXX_INCLUDED
+#define SK_VALUE_WIRE_HXX_INCLUDED
+
+#include <bit>
+#include <climits>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "sk/value.hxx"
+
+/*
+ * msgpack_writer, msgpack_reader, cbor_writer, cbor_reader - MessagePack and
+ * CBOR (RFC 8949) encoding of scalar values and arrays of them.
+ *
+ * Values are written with the native wire type for their type: empty values
+ * as nil (CBOR null), bools as booleans, integers in the smallest encoding
+ * which holds them, float and double as 32- and 64-bit floats, and strings
+ * as UTF-8 strings.  Any other type is written as a string holding its
+ * str().  The writers encode into a caller-supplied buffer and throw
+ * value_format_error if it is too small; apart from the str() fallback they
+ * do not allocate.
+ *
+ * The readers return integers as std::int64_t, or std::uint64_t for values
+ * above INT64_MAX, floats as float or double according to their encoded
+ * width, and both text and binary strings as std::string.  With
+ * value_wire_strings::borrow, strings are returned as borrowed values (see
+ * value::borrow()) pointing into the input, which must then outlive them.
+ * Maps, extension types and nested arrays are rejected with
+ * value_format_error.
+ */
+
+namespace sk {
+
+    enum struct value_wire_strings {
+        copy,   // strings are copied into owned std::strings
+        borrow, // strings refer to the input buffer
+    };
+
+    namespace detail {
+
+        // Call the sink's handler for v's wire type.
+        template <typename Sink, typename T>
+        auto value_wire_visit_as(value const &v, Sink &sink) -> bool {
+            auto const *p = detail::value_probe<T>(&v);
+            if (!p)
+                return false;
+
+            if constexpr (std::same_as<T, bool>)
+                sink.put_bool(*p);
+            else if constexpr (std::same_as<T, float>)
+                sink.put_float(*p);
+            else if constexpr (std::same_as<T, double>)
+                sink.put_double(*p);
+            else if constexpr (std::is_signed_v<T>)
+                sink.put_int(static_cast<std::int64_t>(*p));
+            else
+                sink.put_uint(static_cast<std::uint64_t>(*p));
+            return true;
+        }
+
+        template <typename Sink>
+        void value_wire_visit(value const &v, Sink &sink) {
+            if (v.empty()) {
+                sink.put_nil();
+                return;
+            }
+
+            if (auto s = value_string_view(v)) {
+                sink.put_string(*s);
+                return;
+            }
+
+            if (value_wire_visit_as<Sink, std::int64_t>(v, sink) ||
+                value_wire_visit_as<Sink, int>(v, sink) ||
+                value_wire_visit_as<Sink, double>(v, sink) ||
+                value_wire_visit_as<Sink, bool>(v, sink) ||
+                value_wire_visit_as<Sink, long>(v, sink) ||
+                value_wire_visit_as<Sink, long long>(v, sink) ||
+                value_wire_visit_as<Sink, std::uint64_t>(v, sink) ||
+                value_wire_visit_as<Sink, unsigned int>(v, sink) ||
+                value_wire_visit_as<Sink, unsigned long>(v, sink) ||
+                value_wire_visit_as<Sink, unsigned long long>(v, sink) ||
+                value_wire_visit_as<Sink, float>(v, sink) ||
+                value_wire_visit_as<Sink, short>(v, sink) ||
+                value_wire_visit_as<Sink, unsigned short>(v, sink) ||
+                value_wire_visit_as<Sink, signed char>(v, sink) ||
+                value_wire_visit_as<Sink, unsigned char>(v, sink))
+                return;
+
+            auto s = v.str();
+            sink.put_string(s);
+        }
+
+        // Output cursor over a caller-supplied buffer.
+        class value_wire_out {
+        public:
+            explicit value_wire_out(std::span<std::byte> buffer)
+                : begin(buffer.data()), cur(buffer.data()),
+                  end(buffer.data() + buffer.size()) {}
+
+            auto data() const -> std::span<std::byte const> {
+                return {begin, static_cast<std::size_t>(cur - begin)};
+            }
+
+        protected:
+            void reserve(std::size_t n) {
+                if (static_cast<std::size_t>(end - cur) < n)
+                    throw value_format_error("sk::value: buffer full");
+            }
+
+            void put_byte(unsigned char b) {
+                reserve(1);
+                *cur++ = static_cast<std::byte>(b);
+            }
+
+            // Write a tag byte followed by u as a big-endian U.
+            template <std::unsigned_integral U>
+            void put_be(unsigned char tag, U u) {
+                reserve(1 + sizeof(U));
+                *cur++ = static_cast<std::byte>(tag);
+                for (std::size_t i = sizeof(U); i--;)
+                    *cur++ = static_cast<std::byte>(u >> (i * CHAR_BIT));
+            }
+
+            void put_bytes(std::string_view s) {
+                reserve(s.size());
+                if (!s.empty())
+                    std::memcpy(cur, s.data(), s.size());
+                cur += s.size();
+            }
+
+        private:
+            std::byte *begin, *cur, *end;
+        };
+
+        // Input cursor over an encoded buffer.
+        class value_wire_in {
+        public:
+            value_wire_in(std::span<std::byte const> bytes,
+                          value_wire_strings strings)
+                : cur(bytes.data()), end(bytes.data() + bytes.size()),
+                  strings(strings) {}
+
+            // True once every byte of the input has been read.
+            auto at_end() const -> bool {
+                return cur == end;
+            }
+
+        protected:
+            [[noreturn]] static void fail(char const *what) {
+                throw value_format_error(std::string("sk::value: ") + what);
+            }
+
+            void need(std::uint64_t n) {
+                if (static_cast<std::uint64_t>(end - cur) < n)
+                    fail("truncated value");
+            }
+
+            auto get_byte() -> unsigned char {
+                need(1);
+                return static_cast<unsigned char>(*cur++);
+            }
+
+            template <std::unsigned_integral U> auto get_be() -> U {
+                need(sizeof(U));
+                U u = 0;
+                for (std::size_t i = 0; i < sizeof(U); ++i)
+                    u = static_cast<U>((u << CHAR_BIT) |
+                                       static_cast<unsigned char>(*cur++));
+                return u;
+            }
+
+            auto get_string(std::uint64_t n) -> value {
+                need(n);
+                std::string_view s(reinterpret_cast<char const *>(cur),
+                                   static_cast<std::size_t>(n));
+                cur += n;
+                if (strings == value_wire_strings::borrow)
+                    return value::borrow(s);
+                return value(std::string(s));
+            }
+
+            static auto from_uint(std::uint64_t u) -> value {
+                if (u <= static_cast<std::uint64_t>(
+                             std::numeric_limits<std::int64_t>::max()))
+                    return value(static_cast<std::int64_t>(u));
+                return value(u);
+            }
+
+            auto array_reserve(std::uint64_t n) const -> std::size_t {
+                // Every element takes at least one byte.
+                return static_cast<std::size_t>(
+                    std::min<std::uint64_t>(n, end - cur));
+            }
+
+        private:
+            std::byte const *cur, *end;
+            value_wire_strings strings;
+        };
+
+    } // namespace detail
+
+    /*
+     * Write values as MessagePack.
+     */
+    class msgpack_writer : public detail::value_wire_out {
+    public:
+        explicit msgpack_writer(std::span<std::byte> buffer)
+            : value_wire_out(buffer) {}
+
+        void write(value const &v) {
+            detail::value_wire_visit(v, *this);
+        }
+
+        // Write the values as a MessagePack array.
+        void write_array(std::span<value const> values) {
+            auto n = values.size();
+            if (n < 16)
+                put_byte(static_cast<unsigned char>(0x90 | n));
+            else if (n <= 0xFFFF)
+                put_be(0xDC, static_cast<std::uint16_t>(n));
+            else if (n <= 0xFFFFFFFF)
+                put_be(0xDD, static_cast<std::uint32_t>(n));
+            else
+                throw value_format_error("sk::msgpack_writer: too many values");
+
+            for (auto const &v : values)
+                write(v);
+        }
+
+    private:
+        template <typename Sink>
+        friend void detail::value_wire_visit(value const &, Sink &);
+        template <typename Sink, typename T>
+        friend auto detail::value_wire_visit_as(value const &, Sink &) -> bool;
+
+        void put_nil() {
+            put_byte(0xC0);
+        }
+
+        void put_bool(bool b) {
+            put_byte(b ? 0xC3 : 0xC2);
+        }
+
+        void put_uint(std::uint64_t u) {
+            if (u < 0x80)
+                put_byte(static_cast<unsigned char>(u));
+            else if (u <= 0xFF)
+                put_be(0xCC, static_cast<std::uint8_t>(u));
+            else if (u <= 0xFFFF)
+                put_be(0xCD, static_cast<std::uint16_t>(u));
+            else if (u <= 0xFFFFFFFF)
+                put_be(0xCE, static_cast<std::uint32_t>(u));
+            else
+                put_be(0xCF, u);
+        }
+
+        void put_int(std::int64_t i) {
+            if (i >= 0)
+                put_uint(static_cast<std::uint64_t>(i));
+            else if (i >= -32)
+                put_byte(static_cast<unsigned char>(i));
+            else if (i >= INT8_MIN)
+                put_be(0xD0, static_cast<std::uint8_t>(i));
+            else if (i >= INT16_MIN)
+                put_be(0xD1, static_cast<std::uint16_t>(i));
+            else if (i >= INT32_MIN)
+                put_be(0xD2, static_cast<std::uint32_t>(i));
+            else
+                put_be(0xD3, static_cast<std::uint64_t>(i));
+        }
+
+        void put_float(float f) {
+            put_be(0xCA, std::bit_cast<std::uint32_t>(f));
+        }
+
+        void put_double(double d) {
+            put_be(0xCB, std::bit_cast<std::uint64_t>(d));
+        }
+
+        void put_string(std::string_view s) {
+            auto n = s.size();
+            if (n < 32)
+                put_byte(static_cast<unsigned char>(0xA0 | n));
+            else if (n <= 0xFF)
+                put_be(0xD9, static_cast<std::uint8_t>(n));
+            else if (n <= 0xFFFF)
+                put_be(0xDA, static_cast<std::uint16_t>(n));
+            else if (n <= 0xFFFFFFFF)
+                put_be(0xDB, static_cast<std::uint32_t>(n));
+            else
+                throw value_format_error("sk::msgpack_writer: string too long");
+            put_bytes(s);
+        }
+    };
+
+    /*
+     * Read MessagePack values from a buffer.
+     */
+    class msgpack_reader : public detail::value_wire_in {
+    public:
+        explicit msgpack_reader(
+            std::span<std::byte const> bytes,
+            value_wire_strings strings = value_wire_strings::copy)
+            : value_wire_in(bytes, strings) {}
+
+        // Read the next value.  Returns false at the end of the input.
+        auto read(value &v) -> bool {
+            if (at_end())
+                return false;
+            v = read_scalar(get_byte());
+            return true;
+        }
+
+        // Read the next value, which must be an array of scalars, into
+        // values.  Returns false at the end of the input.
+        auto read_array(std::vector<value> &values) -> bool {
+            if (at_end())
+                return false;
+
+            auto b = get_byte();
+            std::uint64_t n;
+            if ((b & 0xF0) == 0x90)
+                n = b & 0x0F;
+            else if (b == 0xDC)
+                n = get_be<std::uint16_t>();
+            else if (b == 0xDD)
+                n = get_be<std::uint32_t>();
+            else
+                fail("expected an array");
+
+            values.clear();
+            values.reserve(array_reserve(n));
+            while (n--)
+                values.push_back(read_scalar(get_byte()));
+            return true;
+        }
+
+    private:
+        auto read_scalar(unsigned char b) -> value {
+            if (b < 0x80)
+                return value(std::int64_t(b));
+            if (b >= 0xE0)
+                return value(std::int64_t(static_cast<signed char>(b)));
+            if ((b & 0xE0) == 0xA0)
+                return get_string(b & 0x1F);
+
+            switch (b) {
+            case 0xC0:
+                return value();
+            case 0xC2:
+                return value(false);
+            case 0xC3:
+                return value(true);
+            case 0xC4:
+            case 0xD9:
+                return get_string(get_be<std::uint8_t>());
+            case 0xC5:
+            case 0xDA:
+                return get_string(get_be<std::uint16_t>());
+            case 0xC6:
+            case 0xDB:
+                return get_string(get_be<std::uint32_t>());
+            case 0xCA:
+                return value(std::bit_cast<float>(get_be<std::uint32_t>()));
+            case 0xCB:
+                return value(std::bit_cast<double>(get_be<std::uint64_t>()));
+            case 0xCC:
+                return value(std::int64_t(get_be<std::uint8_t>()));
+            case 0xCD:
+                return value(std::int64_t(get_be<std::uint16_t>()));
+            case 0xCE:
+                return value(std::int64_t(get_be<std::uint32_t>()));
+            case 0xCF:
+                return from_uint(get_be<std::uint64_t>());
+            case 0xD0:
+                return value(std::int64_t(
+                    static_cast<std::int8_t>(get_be<std::uint8_t>())));
+            case 0xD1:
+                return value(std::int64_t(
+                    static_cast<std::int16_t>(get_be<std::uint16_t>())));
+            case 0xD2:
+                return value(std::int64_t(
+                    static_cast<std::int32_t>(get_be<std::uint32_t>())));
+            case 0xD3:
+                return value(
+                    static_cast<std::int64_t>(get_be<std::uint64_t>()));
+            default:
+                fail("unsupported MessagePack type");
+            }
+        }
+    };
+
+    /*
+     * Write values as CBOR.
+     */
+    class cbor_writer : public detail::value_wire_out {
+    public:
+        explicit cbor_writer(std::span<std::byte> buffer)
+            : value_wire_out(buffer) {}
+
+        void write(value const &v) {
+            detail::value_wire_visit(v, *this);
+        }
+
+        // Write the values as a definite-length CBOR array.
+        void write_array(std::span<value const> values) {
+            put_head(4, values.size());
+            for (auto const &v : values)
+                write(v);
+        }
+
+    private:
+        template <typename Sink>
+        friend void detail::value_wire_visit(value const &, Sink &);
+        template <typename Sink, typename T>
+        friend auto detail::value_wire_visit_as(value const &, Sink &) -> bool;
+
+        // Write a data item head: the major type and its argument.
+        void put_head(unsigned major, std::uint64_t arg) {
+            auto mt = static_cast<unsigned char>(major << 5);
+            if (arg < 24)
+                put_byte(static_cast<unsigned char>(mt | arg));
+            else if (arg <= 0xFF)
+                put_be(mt | 24, static_cast<std::uint8_t>(arg));
+            else if (arg <= 0xFFFF)
+                put_be(mt | 25, static_cast<std::uint16_t>(arg));
+            else if (arg <= 0xFFFFFFFF)
+                put_be(mt | 26, static_cast<std::uint32_t>(arg));
+            else
+                put_be(mt | 27, arg);
+        }
+
+        void put_nil() {
+            put_byte(0xF6);
+        }
+
+        void put_bool(bool b) {
+            put_byte(b ? 0xF5 : 0xF4);
+        }
+
+        void put_uint(std::uint64_t u) {
+            put_head(0, u);
+        }
+
+        void put_int(std::int64_t i) {
+            if (i >= 0)
+                put_head(0, static_cast<std::uint64_t>(i));
+            else
+                put_head(1, static_cast<std::uint64_t>(-(i + 1)));
+        }
+
+        void put_float(float f) {
+            put_be(0xFA, std::bit_cast<std::uint32_t>(f));
+        }
+
+        void put_double(double d) {
+            put_be(0xFB, std::bit_cast<std::uint64_t>(d));
+        }
+
+        void put_string(std::string_view s) {
+            put_head(3, s.size());
+            put_bytes(s);
+        }
+    };
+
+    /*
+     * Read CBOR values from a buffer.  Semantic tags are skipped, half
+     * precision floats are returned as float, and indefinite-length arrays
+     * are accepted by read_array(); indefinite-length strings are not
+     * supported.
+     */
+    class cbor_reader : public detail::value_wire_in {
+    public:
+        explicit cbor_reader(
+            std::span<std::byte const> bytes,
+            value_wire_strings strings = value_wire_strings::copy)
+            : value_wire_in(bytes, strings) {}
+
+        // Read the next value.  Returns false at the end of the input.
+        auto read(value &v) -> bool {
+            if (at_end())
+                return false;
+            v = read_scalar(get_byte());
+            return true;
+        }
+
+        // Read the next value, which must be an array of scalars, into
+        // values.  Returns false at the end of the input.
+        auto read_array(std::vector<value> &values) -> bool {
+            if (at_end())
+                return false;
+
+            auto b = skip_tags(get_byte());
+            if ((b >> 5) != 4)
+                fail("expected an array");
+
+            values.clear();
+            if ((b & 0x1F) == 31) {
+                while ((b = get_byte()) != 0xFF)
+                    values.push_back(read_scalar(b));
+                return true;
+            }
+
+            auto n = get_arg(b);
+            values.reserve(array_reserve(n));
+            while (n--)
+                values.push_back(read_scalar(get_byte()));
+            return true;
+        }
+
+    private:
+        auto skip_tags(unsigned char b) -> unsigned char {
+            while ((b >> 5) == 6) {
+                get_arg(b);
+                b = get_byte();
+            }
+            return b;
+        }
+
+        auto get_arg(unsigned char b) -> std::uint64_t {
+            switch (auto info = b & 0x1F) {
+            case 24:
+                return get_be<std::uint8_t>();
+            case 25:
+                return get_be<std::uint16_t>();
+            case 26:
+                return get_be<std::uint32_t>();
+            case 27:
+                return get_be<std::uint64_t>();
+            default:
+                if (info >= 28)
+                    fail("unsupported CBOR length");
+                return info;
+            }
+        }
+
+        static auto half_to_float(std::uint16_t h) -> float {
+            auto exp = (h >> 10) & 0x1F;
+            auto mant = h & 0x3FF;
+            float f;
+            if (exp == 0)
+                f = std::ldexp(static_cast<float>(mant), -24);
+            else if (exp == 31)
+                f = mant ? std::numeric_limits<float>::quiet_NaN()
+                         : std::numeric_limits<float>::infinity();
+            else
+                f = std::ldexp(static_cast<float>(mant | 0x400), exp - 25);
+            return (h & 0x8000) ? -f : f;
+        }
+
+        auto read_scalar(unsigned char b) -> value {
+            b = skip_tags(b);
+
+            switch (b >> 5) {
+            case 0:
+                return from_uint(get_arg(b));
+            case 1: {
+                auto u = get_arg(b);
+                if (u > static_cast<std::uint64_t>(
+                            std::numeric_limits<std::int64_t>::max()))
+                    fail("integer out of range");
+                return value(-1 - static_cast<std::int64_t>(u));
+            }
+            case 2:
+            case 3:
+                if ((b & 0x1F) == 31)
+                    fail("indefinite-length strings are not supported");
+                return get_string(get_arg(b));
+            case 7:
+                switch (b) {
+                case 0xF4:
+                    return value(false);
+                case 0xF5:
+                    return value(true);
+                case 0xF6:
+                case 0xF7:
+                    return value();
+                case 0xF9:
+                    return value(half_to_float(get_be<std::uint16_t>()));
+                case 0xFA:
+                    return value(
+                        std::bit_cast<float>(get_be<std::uint32_t>()));
+                case 0xFB:
+                    return value(
+                        std::bit_cast<double>(get_be<std::uint64_t>()));
+                }
+                break;
+            }
+            fail("unsupported CBOR type");
+        }
+    };
+
+} // namespace sk
+
+#endif // SK_VALUE_WIRE_HXX_INCLUDED
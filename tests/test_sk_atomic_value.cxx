@@ -0,0 +1,113 @@
+/*
+ * Copyright(c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license(the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third - parties to whom the Software is furnished to
+ * do so, all subject to the following :
+ *
+ * The copyright notices in the Softwareand this entire statement, including
+ * the above license grant, this restrictionand the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine - executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON - INFRINGEMENT.IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch.hpp>
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "sk/atomic_value.hxx"
+
+TEST_CASE("atomic_value load and store") {
+    sk::atomic_value v;
+    REQUIRE(v.load().empty());
+
+    v.store(sk::value{42});
+    REQUIRE(v.load() == 42);
+    REQUIRE(*v.read() == 42);
+
+    sk::atomic_value s(sk::value{"foo"});
+    {
+        auto r = s.read();
+        s.store(sk::value{"bar"});
+        // The guard still sees the value it was created with.
+        REQUIRE(*r == "foo");
+    }
+    REQUIRE(s.load() == "bar");
+}
+
+TEST_CASE("atomic_value exchange and compare_exchange") {
+    sk::atomic_value v(sk::value{1});
+    REQUIRE(v.exchange(sk::value{2}) == 1);
+
+    sk::value expected{1};
+    REQUIRE(!v.compare_exchange(expected, sk::value{3}));
+    REQUIRE(expected == 2);
+    REQUIRE(v.compare_exchange(expected, sk::value{3}));
+    REQUIRE(v.load() == 3);
+}
+
+TEST_CASE("atomic_value under concurrent readers and writers") {
+    constexpr int writers = 2, readers = 4, updates = 5000;
+
+    sk::atomic_value counter(sk::value{0});
+    sk::atomic_value text(sk::value{std::string(32, 'a')});
+    std::atomic<bool> done{false};
+    std::atomic<int> bad{0};
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < writers; ++i)
+        threads.emplace_back([&, i] {
+            for (int n = 0; n < updates; ++n) {
+                // Increment with a CAS loop.
+                sk::value expected = counter.load();
+                while (!counter.compare_exchange(
+                    expected, sk::value{sk::value_cast<int>(expected) + 1}))
+                    ;
+
+                text.store(sk::value{std::string(32, char('a' + (n + i) % 26))});
+            }
+        });
+
+    for (int i = 0; i < readers; ++i)
+        threads.emplace_back([&] {
+            int last = 0;
+            while (!done.load()) {
+                auto n = sk::value_cast<int>(counter.load());
+                if (n < last)
+                    ++bad;
+                last = n;
+
+                auto r = text.read();
+                auto const &s = sk::value_cast<std::string>(*r);
+                if (s.size() != 32 || s.find_first_not_of(s[0]) != s.npos)
+                    ++bad;
+            }
+        });
+
+    for (int i = 0; i < writers; ++i)
+        threads[i].join();
+    done = true;
+    for (int i = writers; i < writers + readers; ++i)
+        threads[i].join();
+
+    REQUIRE(bad == 0);
+    REQUIRE(counter.load() == writers * updates);
+}
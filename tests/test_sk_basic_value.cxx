@@ -0,0 +1,139 @@
+/*
+ * Copyright(c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license(the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third - parties to whom the Software is furnished to
+ * do so, all subject to the following :
+ *
+ * The copyright notices in the Softwareand this entire statement, including
+ * the above license grant, this restrictionand the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine - executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON - INFRINGEMENT.IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_set>
+
+#include "sk/basic_value.hxx"
+
+namespace {
+
+    using fast_value =
+        sk::basic_value<std::int64_t, double, bool, std::string>;
+
+} // namespace
+
+TEST_CASE("basic_value stores listed types inline") {
+    fast_value e;
+    REQUIRE(e.empty());
+    REQUIRE(e == nullptr);
+
+    fast_value i(std::int64_t(42));
+    REQUIRE(i.is_inline());
+    REQUIRE(i == std::int64_t(42));
+    REQUIRE(sk::value_cast<std::int64_t>(i) == 42);
+    REQUIRE(sk::value_cast<double>(&i) == nullptr);
+    REQUIRE_THROWS_AS(sk::value_cast<double>(i), std::bad_cast);
+
+    fast_value s("foo");
+    REQUIRE(s.is_inline());
+    REQUIRE(s == "foo");
+    REQUIRE(s == std::string("foo"));
+    REQUIRE(s.str() == "foo");
+
+    // Other types are boxed.
+    fast_value b(42);
+    REQUIRE(!b.is_inline());
+    REQUIRE(b == 42);
+    REQUIRE(!(b == std::int64_t(42)));
+    REQUIRE(sk::value_cast<int>(b) == 42);
+    REQUIRE(b.str() == "42");
+
+    fast_value copy(b);
+    REQUIRE(copy == b);
+}
+
+TEST_CASE("basic_value converts to and from value") {
+    REQUIRE(fast_value(sk::value{std::int64_t(7)}).is_inline());
+    REQUIRE(fast_value(sk::value{std::int64_t(7)}) == std::int64_t(7));
+    REQUIRE(fast_value(sk::value{}).empty());
+    REQUIRE(fast_value(sk::value::borrow("bar")) == "bar");
+    REQUIRE(fast_value(sk::value::borrow("bar")).is_inline());
+    REQUIRE(!fast_value(sk::value{1.5f}).is_inline());
+
+    REQUIRE(fast_value(2.5).to_value() == 2.5);
+    REQUIRE(fast_value(1.5f).to_value() == 1.5f);
+    REQUIRE(fast_value().to_value().empty());
+    REQUIRE(fast_value("x").to_value() == "x");
+}
+
+TEST_CASE("basic_value compares and hashes like value") {
+    auto check = [](sk::value const &v) {
+        fast_value f(v);
+        REQUIRE(f == v);
+        REQUIRE(v == f);
+        REQUIRE(f.hash() == std::hash<sk::value>{}(v));
+        REQUIRE(f.str() == v.str());
+        REQUIRE(!(f < v));
+        REQUIRE(!(v < f));
+    };
+    check(sk::value{});
+    check(sk::value{std::int64_t(-3)});
+    check(sk::value{1.5});
+    check(sk::value{true});
+    check(sk::value{"foo"});
+    check(sk::value::borrow("foo"));
+    check(sk::value{42});
+    check(sk::value{'c'});
+
+    REQUIRE(!(fast_value(std::int64_t(1)) == sk::value{1}));
+    REQUIRE(!(fast_value("a") == sk::value{"b"}));
+
+    // Ordering agrees with sk::value for every pair.
+    std::vector<sk::value> values;
+    values.emplace_back();
+    values.emplace_back(std::int64_t(1));
+    values.emplace_back(std::int64_t(2));
+    values.emplace_back(0.5);
+    values.emplace_back(false);
+    values.emplace_back("a");
+    values.emplace_back("b");
+    values.emplace_back(3);
+    values.emplace_back(4);
+    values.emplace_back(2.5f);
+
+    for (auto const &a : values)
+        for (auto const &b : values) {
+            fast_value fa(a), fb(b);
+            INFO(a.str() << " " << b.str());
+            REQUIRE((fa < fb) == (a < b));
+            REQUIRE((fa < b) == (a < b));
+            REQUIRE((a < fb) == (a < b));
+            REQUIRE((fa == fb) == (a == b));
+        }
+
+    std::unordered_set<fast_value> set;
+    set.emplace("foo");
+    set.emplace(std::int64_t(1));
+    REQUIRE(set.contains(fast_value("foo")));
+    REQUIRE(!set.contains(fast_value(1)));
+}
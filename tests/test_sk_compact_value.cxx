@@ -0,0 +1,189 @@
+/*
+ * Copyright(c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license(the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third - parties to whom the Software is furnished to
+ * do so, all subject to the following :
+ *
+ * The copyright notices in the Softwareand this entire statement, including
+ * the above license grant, this restrictionand the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine - executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON - INFRINGEMENT.IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <catch.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "sk/compact_value.hxx"
+
+TEST_CASE("compact_value stores numbers inline") {
+    static_assert(sizeof(sk::compact_value) == 8);
+
+    sk::compact_value e;
+    REQUIRE(e.empty());
+    REQUIRE(e == nullptr);
+    REQUIRE(e.is_inline());
+
+    sk::compact_value d(-2.5);
+    REQUIRE(d.is_inline());
+    REQUIRE(d == -2.5);
+    REQUIRE(sk::value_cast<double>(d) == -2.5);
+    REQUIRE_THROWS_AS(sk::value_cast<int>(d), std::bad_cast);
+
+    sk::compact_value i(-42);
+    REQUIRE(i.is_inline());
+    REQUIRE(i == -42);
+    REQUIRE(!(i == std::int64_t(-42)));
+    REQUIRE(sk::value_cast<int>(i) == -42);
+
+    sk::compact_value b(true);
+    REQUIRE(b.is_inline());
+    REQUIRE(b == true);
+    REQUIRE(b.str() == sk::value{true}.str());
+
+    // 48-bit integers are inline; larger ones are boxed.
+    auto max48 = (std::int64_t(1) << 47) - 1;
+    for (std::int64_t n : {std::int64_t(0), max48, -max48 - 1}) {
+        sk::compact_value c(n);
+        REQUIRE(c.is_inline());
+        REQUIRE(sk::value_cast<std::int64_t>(c) == n);
+    }
+
+    sk::compact_value big(max48 + 1);
+    REQUIRE(!big.is_inline());
+    REQUIRE(sk::value_cast<std::int64_t>(big) == max48 + 1);
+    REQUIRE(big == max48 + 1);
+    REQUIRE(sk::compact_value(max48) < big);
+
+    // Infinities are ordinary doubles, and every NaN is the same NaN.
+    auto inf = std::numeric_limits<double>::infinity();
+    REQUIRE(sk::compact_value(-inf) == -inf);
+    sk::compact_value nan(-std::numeric_limits<double>::quiet_NaN());
+    REQUIRE(nan.is_inline());
+    REQUIRE(std::isnan(sk::value_cast<double>(nan)));
+    REQUIRE(!(nan == nan));
+}
+
+TEST_CASE("compact_value boxes other types") {
+    sk::compact_value s("foo");
+    REQUIRE(!s.is_inline());
+    REQUIRE(s == "foo");
+    REQUIRE(s == std::string("foo"));
+    REQUIRE(sk::value_cast<std::string>(s) == "foo");
+    REQUIRE(*sk::value_cast<std::string>(&s) == "foo");
+    REQUIRE(s.str() == "foo");
+
+    sk::compact_value f(1.5f);
+    REQUIRE(!f.is_inline());
+    REQUIRE(f == 1.5f);
+    REQUIRE(!(f == 1.5));
+
+    sk::compact_value copy(s);
+    REQUIRE(copy == s);
+    sk::compact_value moved(std::move(copy));
+    REQUIRE(moved == "foo");
+    REQUIRE(copy.empty());
+
+    copy = moved;
+    REQUIRE(copy == "foo");
+    copy = sk::compact_value(3);
+    REQUIRE(copy == 3);
+    copy = copy;
+    REQUIRE(copy == 3);
+}
+
+TEST_CASE("compact_value converts to and from value") {
+    REQUIRE(sk::compact_value(sk::value{std::int64_t(7)}).is_inline());
+    REQUIRE(sk::compact_value(sk::value{std::int64_t(7)}) == std::int64_t(7));
+    REQUIRE(sk::compact_value(sk::value{}).empty());
+    REQUIRE(sk::compact_value(sk::value::constant<3>()).is_inline());
+    REQUIRE(sk::compact_value(sk::value::borrow("bar")) == "bar");
+    REQUIRE(sk::compact_value(sk::value::constant<"baz">()) == "baz");
+
+    sk::value v{"moved"};
+    sk::compact_value m(std::move(v));
+    REQUIRE(m == "moved");
+
+    REQUIRE(sk::compact_value(2.5).to_value() == 2.5);
+    REQUIRE(sk::compact_value(1.5f).to_value() == 1.5f);
+    REQUIRE(sk::compact_value().to_value().empty());
+    REQUIRE(sk::compact_value("x").to_value() == "x");
+}
+
+TEST_CASE("compact_value compares and hashes like value") {
+    auto check = [](sk::value const &v) {
+        sk::compact_value c(v);
+        REQUIRE(c == v);
+        REQUIRE(v == c);
+        REQUIRE(c.hash() == std::hash<sk::value>{}(v));
+        REQUIRE(c.str() == v.str());
+        REQUIRE(c.type() == v.object->type());
+        REQUIRE(!(c < v));
+        REQUIRE(!(v < c));
+    };
+    check(sk::value{});
+    check(sk::value{std::int64_t(-3)});
+    check(sk::value{std::int64_t(1) << 60});
+    check(sk::value{1.5});
+    check(sk::value{-0.0});
+    check(sk::value{true});
+    check(sk::value{-7});
+    check(sk::value{"foo"});
+    check(sk::value::borrow("foo"));
+    check(sk::value{'c'});
+
+    // Ordering agrees with sk::value for every pair.
+    std::vector<sk::value> values;
+    values.emplace_back();
+    values.emplace_back(std::int64_t(-1));
+    values.emplace_back(std::int64_t(2));
+    values.emplace_back(std::int64_t(1) << 60);
+    values.emplace_back(-(std::int64_t(1) << 60));
+    values.emplace_back(0.5);
+    values.emplace_back(-0.5);
+    values.emplace_back(false);
+    values.emplace_back(true);
+    values.emplace_back("a");
+    values.emplace_back("b");
+    values.emplace_back(3);
+    values.emplace_back(-4);
+    values.emplace_back(2.5f);
+
+    for (auto const &a : values)
+        for (auto const &b : values) {
+            sk::compact_value ca(a), cb(b);
+            INFO(a.str() << " " << b.str());
+            REQUIRE((ca < cb) == (a < b));
+            REQUIRE((ca < b) == (a < b));
+            REQUIRE((a < cb) == (a < b));
+            REQUIRE((ca == cb) == (a == b));
+            REQUIRE((ca == b) == (a == b));
+        }
+
+    std::unordered_set<sk::compact_value> set;
+    set.emplace("foo");
+    set.emplace(1);
+    REQUIRE(set.contains(sk::compact_value("foo")));
+    REQUIRE(!set.contains(sk::compact_value(1.0)));
+}
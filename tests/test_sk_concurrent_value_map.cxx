@@ -0,0 +1,106 @@
+/*
+ * Copyright(c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license(the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third - parties to whom the Software is furnished to
+ * do so, all subject to the following :
+ *
+ * The copyright notices in the Softwareand this entire statement, including
+ * the above license grant, this restrictionand the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine - executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON - INFRINGEMENT.IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch.hpp>
+
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "sk/concurrent_value_map.hxx"
+
+TEST_CASE("concurrent_value_map basic operations") {
+    sk::concurrent_value_map<int> map(8);
+    REQUIRE(map.shard_count() == 8);
+    REQUIRE(map.empty());
+
+    REQUIRE(map.insert(42, 1));
+    REQUIRE(!map.insert(42, 2));
+    REQUIRE(map.try_emplace("foo", 3));
+    REQUIRE(map.insert(sk::value{1.5}, 4));
+
+    REQUIRE(map.size() == 3);
+    REQUIRE(map.find(42) == 1);
+    REQUIRE(map.find(sk::value{42}) == 1);
+    REQUIRE(map.find(std::string_view("foo")) == 3);
+    REQUIRE(map.find("foo") == 3);
+    REQUIRE(map.find(std::string("foo")) == 3);
+    REQUIRE(!map.find(43));
+    REQUIRE(map.contains(1.5));
+
+    REQUIRE(!map.insert_or_assign(42, 5));
+    REQUIRE(map.find(42) == 5);
+
+    REQUIRE(map.update("foo", [](int &v) { ++v; }));
+    REQUIRE(!map.update("bar", [](int &v) { ++v; }));
+    int seen = 0;
+    REQUIRE(map.visit("foo", [&](int const &v) { seen = v; }));
+    REQUIRE(seen == 4);
+
+    int sum = 0;
+    map.for_each([&](sk::value const &, int v) { sum += v; });
+    REQUIRE(sum == 5 + 4 + 4);
+
+    REQUIRE(map.erase("foo") == 1);
+    REQUIRE(map.erase("foo") == 0);
+    REQUIRE(map.size() == 2);
+
+    map.clear();
+    REQUIRE(map.empty());
+}
+
+TEST_CASE("concurrent_value_map rounds the shard count up") {
+    REQUIRE(sk::concurrent_value_map<int>(5).shard_count() == 8);
+    REQUIRE(sk::concurrent_value_map<int>(1).shard_count() == 1);
+    REQUIRE(sk::concurrent_value_map<int>().shard_count() >= 4);
+}
+
+TEST_CASE("concurrent_value_map from several threads") {
+    constexpr int threads = 8, keys = 2000;
+
+    sk::concurrent_value_map<int> map(16);
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+        workers.emplace_back([&, t] {
+            for (int i = 0; i < keys; ++i) {
+                map.try_emplace(i, 0);
+                map.update(i, [](int &v) { ++v; });
+                map.insert_or_assign("thread" + std::to_string(t), i);
+                (void)map.find(i - 1);
+            }
+        });
+    for (auto &w : workers)
+        w.join();
+
+    REQUIRE(map.size() == keys + threads);
+    for (int i = 0; i < keys; ++i)
+        REQUIRE(map.find(i) == threads);
+    for (int t = 0; t < threads; ++t)
+        REQUIRE(map.find("thread" + std::to_string(t)) == keys - 1);
+}
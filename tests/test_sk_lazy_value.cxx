@@ -0,0 +1,105 @@
+/*
+ * Copyright(c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license(the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third - parties to whom the Software is furnished to
+ * do so, all subject to the following :
+ *
+ * The copyright notices in the Softwareand this entire statement, including
+ * the above license grant, this restrictionand the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine - executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON - INFRINGEMENT.IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch.hpp>
+
+#include <cstring>
+#include <string>
+#include <unordered_set>
+
+#include "sk/lazy_value.hxx"
+
+namespace {
+
+    int decode_count = 0;
+
+    // Decode a little-endian int.
+    auto decode_int(std::span<std::byte const> bytes) -> sk::value {
+        ++decode_count;
+        int i;
+        std::memcpy(&i, bytes.data(), sizeof(i));
+        return sk::value{i};
+    }
+
+    auto lazy_int(int i) -> sk::lazy_value {
+        std::vector<std::byte> bytes(sizeof(i));
+        std::memcpy(bytes.data(), &i, sizeof(i));
+        return sk::lazy_value(std::move(bytes), decode_int);
+    }
+
+} // namespace
+
+TEST_CASE("lazy_value decodes on first use") {
+    decode_count = 0;
+
+    auto a = lazy_int(42), b = lazy_int(43), unused = lazy_int(44);
+    REQUIRE(decode_count == 0);
+    REQUIRE(!a.is_decoded());
+    REQUIRE(a.raw().size() == sizeof(int));
+
+    REQUIRE(a == 42);
+    REQUIRE(decode_count == 1);
+    REQUIRE(a.is_decoded());
+    REQUIRE(a.raw().empty());
+    // The buffer is freed, not only cleared.
+    REQUIRE(a.raw().data() == nullptr);
+
+    REQUIRE(a < b);
+    REQUIRE(decode_count == 2);
+
+    // Decoded values are cached.
+    REQUIRE(a.str() == "42");
+    REQUIRE(std::hash<sk::lazy_value>{}(b) == std::hash<int>{}(43));
+    REQUIRE(sk::value_cast<int>(a) == 42);
+    REQUIRE(*sk::value_cast<int>(&b) == 43);
+    REQUIRE(sk::value_cast<long>(&b) == nullptr);
+    REQUIRE(decode_count == 2);
+
+    REQUIRE(!unused.is_decoded());
+}
+
+TEST_CASE("lazy_value comparisons with values") {
+    auto a = lazy_int(1);
+    sk::value v{1}, w{"x"};
+
+    REQUIRE(a == v);
+    REQUIRE(!(a == w));
+    REQUIRE(!(a < v));
+    REQUIRE(!(v < a));
+    REQUIRE(sk::lazy_value() == sk::value());
+    REQUIRE(sk::lazy_value().empty());
+    REQUIRE(sk::lazy_value(sk::value{"foo"}) == "foo");
+
+    std::unordered_set<sk::lazy_value> set;
+    set.insert(lazy_int(5));
+    REQUIRE(set.contains(lazy_int(5)));
+    REQUIRE(!set.contains(lazy_int(6)));
+
+    sk::value const &ref = a;
+    REQUIRE(ref == 1);
+}
@@ -30,9 +30,11 @@
 #include <catch.hpp>
 
 #include <cstring>
+#include <span>
 #include <sstream>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #include "sk/value.hxx"
 
@@ -138,3 +140,198 @@ TEST_CASE("value reference construction") {
     v = s;
     v = sref;
 }
+
+TEST_CASE("borrowed string value") {
+    char buf[] = "foo";
+    auto v = sk::value::borrow(buf);
+    sk::value owned{"foo"}, other{"bar"};
+
+    // Compares and hashes like an owned std::string.
+    REQUIRE(v == owned);
+    REQUIRE(owned == v);
+    REQUIRE(v == "foo");
+    REQUIRE(v == std::string("foo"));
+    REQUIRE(v != other);
+    REQUIRE(other < v);
+    REQUIRE(!(v < owned));
+    REQUIRE(!(owned < v));
+    REQUIRE(((v < sk::value{1}) == (owned < sk::value{1})));
+    REQUIRE(std::hash<sk::value>{}(v) == std::hash<sk::value>{}(owned));
+    REQUIRE(v.str() == "foo");
+    REQUIRE(*sk::value_string_view(v) == "foo");
+    REQUIRE(sk::value_string_view(v)->data() == buf);
+    REQUIRE(sk::value_cast<std::string>(v) == "foo");
+    REQUIRE(sk::value_cast<int>(&v) == nullptr);
+
+    // Copies are owned.
+    sk::value copy{v};
+    REQUIRE(copy == "foo");
+    REQUIRE(sk::value_string_view(copy)->data() != buf);
+
+    v.detach();
+    REQUIRE(sk::value_string_view(v)->data() != buf);
+    buf[0] = 'g';
+    REQUIRE(v == "foo");
+    REQUIRE(copy == "foo");
+}
+
+namespace {
+
+    constinit sk::value constant_int = sk::value::constant<42>();
+    constinit sk::value constant_string = sk::value::constant<"N/A">();
+    constinit sk::value constant_double = sk::value::constant<1.5>();
+
+} // namespace
+
+TEST_CASE("constant value") {
+    REQUIRE(constant_int == 42);
+    REQUIRE(constant_int == sk::value{42});
+    REQUIRE(sk::value{42} == constant_int);
+    REQUIRE(!(constant_int == 42L));
+    REQUIRE(sk::value_cast<int>(constant_int) == 42);
+    REQUIRE(std::hash<sk::value>{}(constant_int) ==
+            std::hash<sk::value>{}(sk::value{42}));
+    REQUIRE(constant_int.str() == "42");
+    REQUIRE(sk::value{41} < constant_int);
+    REQUIRE(constant_int < sk::value{43});
+    REQUIRE(!constant_int.empty());
+
+    REQUIRE(constant_string == "N/A");
+    REQUIRE(constant_string == sk::value{"N/A"});
+    REQUIRE(sk::value{"N/A"} == constant_string);
+    REQUIRE(sk::value_cast<std::string>(constant_string) == "N/A");
+    REQUIRE(std::hash<sk::value>{}(constant_string) ==
+            std::hash<sk::value>{}(sk::value{"N/A"}));
+
+    REQUIRE(constant_double == 1.5);
+
+    // Copies are ordinary values; the constant itself is never freed.
+    sk::value copy{constant_int};
+    REQUIRE(copy == constant_int);
+    {
+        sk::value v = sk::value::constant<42>();
+        REQUIRE(v == 42);
+    }
+    REQUIRE(constant_int == 42);
+
+    sk::value assigned;
+    assigned = sk::value::constant<"N/A">();
+    assigned = 7;
+    REQUIRE(constant_string == "N/A");
+}
+
+namespace {
+
+    enum struct colour : int { red, green };
+
+    struct point {
+        int x, y;
+        auto operator==(point const &) const -> bool = default;
+    };
+
+    // Equal when the last digits are equal, so not bytewise equal.
+    struct last_digit {
+        int v;
+        auto operator==(last_digit const &o) const -> bool {
+            return v % 10 == o.v % 10;
+        }
+    };
+
+    struct owns_buffer {
+        std::vector<char> buffer;
+        auto operator==(owns_buffer const &) const -> bool = default;
+    };
+
+    auto value_heap_usage(owns_buffer const &o) -> std::size_t {
+        return o.buffer.capacity();
+    }
+
+} // namespace
+
+template <> inline constexpr bool sk::value_bytewise_equal<point> = true;
+
+template <> struct std::hash<last_digit> {
+    auto operator()(last_digit const &d) const -> std::size_t {
+        return std::hash<int>{}(d.v % 10);
+    }
+};
+
+template <> struct std::hash<point> {
+    auto operator()(point const &p) const -> std::size_t {
+        return std::hash<int>{}(p.x) ^ std::hash<int>{}(p.y);
+    }
+};
+
+template <> struct std::hash<owns_buffer> {
+    auto operator()(owns_buffer const &o) const -> std::size_t {
+        return o.buffer.size();
+    }
+};
+
+TEST_CASE("value memory usage") {
+    auto base = sk::value_memory_usage(sk::value{0});
+    REQUIRE(base >= sizeof(sk::value) + sizeof(int));
+
+    // A short string is stored inline; a long one owns its buffer.
+    sk::value short_string{std::string("abc")};
+    sk::value long_string{std::string(1000, 'x')};
+    REQUIRE(sk::value_memory_usage(long_string) >=
+            sk::value_memory_usage(short_string) + 1000);
+
+    // Borrowed characters and constants are not owned by the value.
+    sk::value borrowed = sk::value::borrow(std::string_view("0123456789"));
+    REQUIRE(sk::value_memory_usage(borrowed) < 1000);
+    REQUIRE(sk::value_memory_usage(sk::value::constant<42>()) ==
+            sizeof(sk::value));
+
+    // Casting a borrowed string to std::string makes a copy which it owns.
+    std::string const text(1000, 'y');
+    sk::value borrowed_long = sk::value::borrow(std::string_view(text));
+    REQUIRE(sk::value_memory_usage(borrowed_long) < 1000);
+    REQUIRE(sk::value_cast<std::string>(&borrowed_long) != nullptr);
+    REQUIRE(sk::value_memory_usage(borrowed_long) >= sizeof(sk::value) + 1000);
+
+    // User types can say what they own.
+    sk::value user{owns_buffer{std::vector<char>(500)}};
+    REQUIRE(sk::value_memory_usage(user) >= sizeof(sk::value) + 500);
+
+    std::vector<sk::value> values;
+    values.reserve(10);
+    values.emplace_back(0);
+    values.push_back(long_string);
+    REQUIRE(sk::value_memory_usage(values) ==
+            base + sk::value_memory_usage(long_string) +
+                8 * sizeof(sk::value));
+    REQUIRE(sk::value_memory_usage(std::span<sk::value const>(values)) ==
+            base + sk::value_memory_usage(long_string));
+}
+
+TEST_CASE("trivially copyable values compare as bytes") {
+    static_assert(sk::value_trivial<int>);
+    static_assert(sk::value_trivial<point>);
+    static_assert(!sk::value_trivial<double>);
+    static_assert(!sk::value_trivial<std::string>);
+    static_assert(!sk::value_trivial<colour>);
+    static_assert(!sk::value_trivial<last_digit>);
+
+    // Types which have not opted in keep their own operator==.
+    REQUIRE(sk::value{last_digit{1}} == sk::value{last_digit{11}});
+    REQUIRE(sk::value{last_digit{1}} != sk::value{last_digit{12}});
+
+    REQUIRE(sk::value{point{1, 2}} == sk::value{point{1, 2}});
+    REQUIRE(sk::value{point{1, 2}} != sk::value{point{2, 1}});
+    REQUIRE(sk::value{colour::green} == sk::value{colour::green});
+    REQUIRE(sk::value{colour::green} != sk::value{colour::red});
+
+    // Objects of the same size but a different type are never equal.
+    REQUIRE(sk::value{1} != sk::value{1u});
+    REQUIRE(sk::value{1} != sk::value{colour::green});
+    REQUIRE(sk::value{0} != sk::value{0.0f});
+    REQUIRE(sk::value{1} != sk::value{"1"});
+
+    REQUIRE(sk::value{42} == sk::value::constant<42>());
+    REQUIRE(sk::value{41} != sk::value::constant<42>());
+
+    sk::value copy{sk::value{point{3, 4}}};
+    REQUIRE(sk::value_cast<point>(copy) == point{3, 4});
+}
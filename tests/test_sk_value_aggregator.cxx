@@ -0,0 +1,238 @@
+/*
+ * Copyright(c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license(the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third - parties to whom the Software is furnished to
+ * do so, all subject to the following :
+ *
+ * The copyright notices in the Softwareand this entire statement, including
+ * the above license grant, this restrictionand the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine - executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON - INFRINGEMENT.IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <catch.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <random>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "sk/value_aggregator.hxx"
+
+namespace {
+
+    using sk::value_aggregate;
+    using column = std::vector<sk::value>;
+
+    void add(sk::value_aggregator &agg, std::vector<column> const &keys,
+             std::vector<column> const &inputs) {
+        std::vector<std::span<sk::value const>> k(keys.begin(), keys.end());
+        std::vector<std::span<sk::value const>> in(inputs.begin(),
+                                                   inputs.end());
+        agg.add(k, in);
+    }
+
+    // Find the group with the given keys.
+    auto group_of(sk::value_aggregator const &agg,
+                  std::vector<sk::value> const &keys) -> std::size_t {
+        for (std::size_t g = 0; g < agg.size(); ++g) {
+            auto k = agg.key(g);
+            if (std::equal(k.begin(), k.end(), keys.begin(), keys.end()))
+                return g;
+        }
+        FAIL("no such group");
+        return 0;
+    }
+
+    template <typename... Ts> auto make_column(Ts &&...vs) {
+        column c;
+        (c.emplace_back(std::forward<Ts>(vs)), ...);
+        return c;
+    }
+
+} // namespace
+
+TEST_CASE("value_aggregator groups by a single key") {
+    sk::value_aggregator agg(
+        1, {value_aggregate::count, value_aggregate::sum, value_aggregate::min,
+            value_aggregate::max, value_aggregate::avg});
+
+    auto keys = make_column("a", "b", "a", "a", "b", "c");
+    auto amounts = make_column(1, 10, 2, 3, 20, nullptr);
+    add(agg, {keys}, {amounts, amounts, amounts, amounts, amounts});
+
+    REQUIRE(agg.size() == 3);
+
+    auto a = group_of(agg, make_column("a"));
+    REQUIRE(agg.result(a, 0) == std::int64_t(3));
+    REQUIRE(agg.result(a, 1) == std::int64_t(6));
+    REQUIRE(agg.result(a, 2) == 1);
+    REQUIRE(agg.result(a, 3) == 3);
+    REQUIRE(agg.result(a, 4) == 2.0);
+
+    // A group whose only input is empty.
+    auto c = group_of(agg, make_column("c"));
+    REQUIRE(agg.result(c, 0) == std::int64_t(0));
+    REQUIRE(agg.result(c, 1).empty());
+    REQUIRE(agg.result(c, 2).empty());
+    REQUIRE(agg.result(c, 4).empty());
+
+    // More batches add to the same groups; doubles make the sum a double.
+    add(agg, {make_column("b", "d")}, {make_column(1.5, 4.0),
+                                        make_column(1.5, 4.0),
+                                        make_column(1.5, 4.0),
+                                        make_column(1.5, 4.0),
+                                        make_column(1.5, 4.0)});
+    REQUIRE(agg.size() == 4);
+    auto b = group_of(agg, make_column("b"));
+    REQUIRE(agg.result(b, 0) == std::int64_t(3));
+    REQUIRE(agg.result(b, 1) == 31.5);
+    // Mixed types are ordered as sk::value orders them.
+    sk::value ten{10}, twenty{20}, one_half{1.5};
+    REQUIRE(agg.result(b, 2) == (ten < one_half ? ten : one_half));
+    REQUIRE(agg.result(b, 3) == (ten < one_half ? one_half : twenty));
+    REQUIRE(agg.result(b, 4) == 10.5);
+}
+
+TEST_CASE("value_aggregator groups by several keys") {
+    sk::value_aggregator agg(2, {value_aggregate::count});
+    add(agg,
+        {make_column("x", "x", "y", "x", "y"),
+         make_column(1, 2, 1, 1, std::int64_t(1))},
+        {column{}});
+
+    REQUIRE(agg.size() == 4);
+    REQUIRE(agg.result(group_of(agg, make_column("x", 1)), 0) ==
+            std::int64_t(2));
+    REQUIRE(agg.result(group_of(agg, make_column("y", 1)), 0) ==
+            std::int64_t(1));
+    REQUIRE(agg.result(group_of(agg, make_column("y", std::int64_t(1))), 0) ==
+            std::int64_t(1));
+}
+
+TEST_CASE("value_aggregator aggregates non-numeric values") {
+    sk::value_aggregator agg(1, {value_aggregate::min, value_aggregate::max,
+                                 value_aggregate::count});
+    auto names = make_column("pear", "apple", "fig");
+    add(agg, {make_column(1, 1, 1)}, {names, names, names});
+
+    REQUIRE(agg.result(0, 0) == "apple");
+    REQUIRE(agg.result(0, 1) == "pear");
+    REQUIRE(agg.result(0, 2) == std::int64_t(3));
+
+    sk::value_aggregator sums(1, {value_aggregate::sum});
+    REQUIRE_THROWS_AS(add(sums, {make_column(1)}, {make_column("x")}),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(add(sums, {make_column(1, 2)}, {make_column(1)}),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(add(sums, {}, {}), std::invalid_argument);
+}
+
+TEST_CASE("value_aggregator leaves a batch which throws unapplied") {
+    sk::value_aggregator agg(1, {value_aggregate::count, value_aggregate::sum});
+    add(agg, {make_column(1)}, {column{}, make_column(5)});
+
+    REQUIRE_THROWS_AS(
+        add(agg, {make_column(1, 2)}, {column{}, make_column(1, "s")}),
+        std::invalid_argument);
+    REQUIRE(agg.size() == 1);
+    REQUIRE(agg.result(0, 0) == std::int64_t(1));
+    REQUIRE(agg.result(0, 1) == std::int64_t(5));
+}
+
+TEST_CASE("value_aggregator sums which overflow std::int64_t") {
+    constexpr auto max = std::numeric_limits<std::int64_t>::max();
+    constexpr auto huge = std::numeric_limits<unsigned long long>::max();
+
+    constexpr auto min = std::numeric_limits<std::int64_t>::min();
+
+    sk::value_aggregator agg(1, {value_aggregate::sum});
+    add(agg, {make_column(1, 1, 2, 2, 3, 4, 4)},
+        {make_column(max, std::int64_t(1), huge, 1ull, max - 1, min, -1)});
+
+    // Overflowing sums fall back to double.
+    REQUIRE(agg.result(group_of(agg, make_column(1)), 0) ==
+            static_cast<double>(max) + 1);
+    REQUIRE(agg.result(group_of(agg, make_column(2)), 0) ==
+            static_cast<double>(huge) + 1);
+    REQUIRE(agg.result(group_of(agg, make_column(3)), 0) == max - 1);
+    REQUIRE(agg.result(group_of(agg, make_column(4)), 0) ==
+            static_cast<double>(min) - 1);
+
+    // So do partial sums which overflow when merged.
+    sk::value_aggregator other(1, {value_aggregate::sum});
+    add(other, {make_column(3)}, {make_column(std::int64_t(2))});
+    agg.merge(other);
+    REQUIRE(agg.result(group_of(agg, make_column(3)), 0) ==
+            static_cast<double>(max) + 1);
+}
+
+TEST_CASE("value_aggregator merges partial aggregates") {
+    std::vector<value_aggregate> aggregates{
+        value_aggregate::count, value_aggregate::sum, value_aggregate::min,
+        value_aggregate::max};
+
+    // Build the same rows both in one aggregator and split over threads.
+    std::mt19937 rng(11);
+    column keys, amounts;
+    for (int i = 0; i < 20000; ++i) {
+        keys.emplace_back(int(rng() % 500));
+        amounts.emplace_back(int(rng() % 1000) - 500);
+    }
+
+    sk::value_aggregator whole(1, aggregates);
+    add(whole, {keys}, {amounts, amounts, amounts, amounts});
+
+    constexpr int threads = 4;
+    std::vector<sk::value_aggregator> parts(threads,
+                                            sk::value_aggregator(1, aggregates));
+    std::vector<std::thread> workers;
+    auto per_thread = keys.size() / threads;
+    for (int t = 0; t < threads; ++t)
+        workers.emplace_back([&, t] {
+            std::span<sk::value const> k(keys.data() + t * per_thread,
+                                         per_thread);
+            std::span<sk::value const> a(amounts.data() + t * per_thread,
+                                         per_thread);
+            std::span<sk::value const> key_columns[] = {k};
+            std::span<sk::value const> inputs[] = {a, a, a, a};
+            parts[t].add(key_columns, inputs);
+        });
+    for (auto &w : workers)
+        w.join();
+
+    for (int t = 1; t < threads; ++t)
+        parts[0].merge(parts[t]);
+
+    REQUIRE(parts[0].size() == whole.size());
+    for (std::size_t g = 0; g < whole.size(); ++g) {
+        auto k = whole.key(g);
+        auto pg = group_of(parts[0], std::vector<sk::value>(k.begin(), k.end()));
+        for (std::size_t a = 0; a < aggregates.size(); ++a)
+            REQUIRE(parts[0].result(pg, a) == whole.result(g, a));
+    }
+
+    sk::value_aggregator other(1, {value_aggregate::avg});
+    REQUIRE_THROWS_AS(whole.merge(other), std::invalid_argument);
+}
@@ -0,0 +1,186 @@
+/*
+ * Copyright(c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license(the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third - parties to whom the Software is furnished to
+ * do so, all subject to the following :
+ *
+ * The copyright notices in the Softwareand this entire statement, including
+ * the above license grant, this restrictionand the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine - executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON - INFRINGEMENT.IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "sk/value_arrow.hxx"
+
+namespace {
+
+    template <typename... Ts> auto make_column(Ts &&...cells) {
+        std::vector<sk::value> column;
+        (column.emplace_back(std::forward<Ts>(cells)), ...);
+        return column;
+    }
+
+    // Export a column and import it straight back.
+    auto round_trip(std::vector<sk::value> const &column)
+        -> std::vector<sk::value> {
+        ArrowArray array;
+        ArrowSchema schema;
+        sk::export_arrow(column, &array, &schema);
+
+        std::vector<sk::value> out;
+        sk::import_arrow(array, schema, out);
+        array.release(&array);
+        schema.release(&schema);
+        REQUIRE(array.release == nullptr);
+        REQUIRE(schema.release == nullptr);
+        return out;
+    }
+
+} // namespace
+
+TEST_CASE("export_arrow integer column") {
+    auto column = make_column(std::int32_t(1), sk::value{}, std::int32_t(-3));
+
+    ArrowArray array;
+    ArrowSchema schema;
+    sk::export_arrow(column, &array, &schema, "x");
+
+    REQUIRE(std::string(schema.format) == "i");
+    REQUIRE(std::string(schema.name) == "x");
+    REQUIRE(array.length == 3);
+    REQUIRE(array.null_count == 1);
+    REQUIRE(array.n_buffers == 2);
+
+    auto const *validity =
+        static_cast<unsigned char const *>(array.buffers[0]);
+    REQUIRE(validity[0] == 0b101);
+
+    std::int32_t data[3];
+    std::memcpy(data, array.buffers[1], sizeof(data));
+    REQUIRE(data[0] == 1);
+    REQUIRE(data[2] == -3);
+
+    array.release(&array);
+    schema.release(&schema);
+}
+
+TEST_CASE("export_arrow string column") {
+    auto column = make_column("foo", sk::value::borrow("ba"), "");
+
+    ArrowArray array;
+    ArrowSchema schema;
+    sk::export_arrow(column, &array, &schema);
+
+    REQUIRE(std::string(schema.format) == "u");
+    REQUIRE(array.null_count == 0);
+    REQUIRE(array.buffers[0] == nullptr);
+    REQUIRE(array.n_buffers == 3);
+
+    std::int32_t offsets[4];
+    std::memcpy(offsets, array.buffers[1], sizeof(offsets));
+    REQUIRE(offsets[0] == 0);
+    REQUIRE(offsets[1] == 3);
+    REQUIRE(offsets[2] == 5);
+    REQUIRE(offsets[3] == 5);
+    REQUIRE(std::string_view(static_cast<char const *>(array.buffers[2]), 5) ==
+            "fooba");
+
+    array.release(&array);
+    schema.release(&schema);
+}
+
+TEST_CASE("export_arrow round-trips") {
+    REQUIRE(round_trip(make_column(true, false, sk::value{}, true)) ==
+            make_column(true, false, sk::value{}, true));
+    REQUIRE(round_trip(make_column(1.5, 2.5)) == make_column(1.5, 2.5));
+    REQUIRE(round_trip(make_column(1.5f)) == make_column(1.5f));
+    REQUIRE(round_trip(make_column(std::int64_t(1) << 40)) ==
+            make_column(std::int64_t(1) << 40));
+    REQUIRE(round_trip(make_column(std::uint16_t(7))) ==
+            make_column(std::uint16_t(7)));
+    REQUIRE(round_trip(make_column("a", sk::value{}, "b")) ==
+            make_column("a", sk::value{}, "b"));
+
+    auto nulls = round_trip(make_column(sk::value{}, sk::value{}));
+    REQUIRE(nulls.size() == 2);
+    REQUIRE(nulls[0].empty());
+
+    REQUIRE(round_trip(make_column()).empty());
+
+    std::vector<sk::value> many;
+    for (int i = 0; i < 100; ++i)
+        many.emplace_back(i % 7 ? sk::value{i} : sk::value{});
+    REQUIRE(round_trip(many) == many);
+}
+
+TEST_CASE("export_arrow rejects mixed and unsupported columns") {
+    ArrowArray array;
+    ArrowSchema schema;
+
+    auto mixed = make_column(1, "x");
+    REQUIRE_THROWS_AS(sk::export_arrow(mixed, &array, &schema),
+                      std::invalid_argument);
+
+    // char has no Arrow equivalent.
+    auto user = make_column('c');
+    REQUIRE_THROWS_AS(sk::export_arrow(user, &array, &schema),
+                      std::invalid_argument);
+}
+
+TEST_CASE("import_arrow honours the offset and borrows strings") {
+    std::int32_t offsets[] = {0, 1, 3, 6};
+    char const data[] = "abbccc";
+    unsigned char validity[] = {0b1011};
+    void const *buffers[] = {validity, offsets, data};
+
+    ArrowArray array{};
+    array.length = 2;
+    array.offset = 1;
+    array.null_count = 1;
+    array.n_buffers = 3;
+    array.buffers = buffers;
+    array.release = [](ArrowArray *a) { a->release = nullptr; };
+
+    ArrowSchema schema{};
+    schema.format = "u";
+    schema.release = [](ArrowSchema *s) { s->release = nullptr; };
+
+    std::vector<sk::value> out;
+    sk::import_arrow(array, schema, out, sk::value_wire_strings::borrow);
+    REQUIRE(out.size() == 2);
+    REQUIRE(out[0] == "bb");
+    REQUIRE(out[1].empty());
+    REQUIRE(sk::value_string_view(out[0])->data() == data + 1);
+
+    schema.format = "+s";
+    REQUIRE_THROWS_AS(sk::import_arrow(array, schema, out),
+                      sk::value_format_error);
+
+    schema.format = "u";
+    array.release(&array);
+    REQUIRE_THROWS_AS(sk::import_arrow(array, schema, out),
+                      sk::value_format_error);
+}
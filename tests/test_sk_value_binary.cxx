@@ -0,0 +1,201 @@
+/*
+ * Copyright(c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license(the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third - parties to whom the Software is furnished to
+ * do so, all subject to the following :
+ *
+ * The copyright notices in the Softwareand this entire statement, including
+ * the above license grant, this restrictionand the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine - executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON - INFRINGEMENT.IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch.hpp>
+
+#include <cstdio>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "sk/value_binary.hxx"
+
+namespace {
+
+    struct point {
+        int x, y;
+        auto operator==(point const &) const -> bool = default;
+    };
+
+} // namespace
+
+template <> struct std::hash<point> {
+    auto operator()(point const &p) const -> std::size_t {
+        return std::hash<int>{}(p.x) ^ std::hash<int>{}(p.y);
+    }
+};
+
+namespace {
+
+    auto sample_values() -> std::vector<sk::value> {
+        std::vector<sk::value> v;
+        v.emplace_back();
+        v.emplace_back(true);
+        v.emplace_back(false);
+        v.emplace_back('c');
+        v.emplace_back(static_cast<signed char>(-5));
+        v.emplace_back(static_cast<short>(-300));
+        v.emplace_back(42);
+        v.emplace_back(std::numeric_limits<int>::min());
+        v.emplace_back(-1L);
+        v.emplace_back(std::numeric_limits<long long>::max());
+        v.emplace_back(static_cast<unsigned char>(200));
+        v.emplace_back(static_cast<unsigned short>(65535));
+        v.emplace_back(7u);
+        v.emplace_back(std::numeric_limits<unsigned long>::max());
+        v.emplace_back(0ull);
+        v.emplace_back(1.5f);
+        v.emplace_back(-2.25);
+        v.emplace_back("");
+        v.emplace_back(std::string(1000, 'x'));
+        return v;
+    }
+
+} // namespace
+
+TEST_CASE("value_writer and value_reader round trip through a buffer") {
+    auto values = sample_values();
+    std::vector<std::byte> buf(4096);
+
+    sk::value_writer w(buf);
+    for (auto const &v : values)
+        w.write(v);
+
+    sk::value_reader r(w.data());
+    for (auto const &expected : values) {
+        sk::value v;
+        REQUIRE(r.read(v));
+        REQUIRE(v == expected);
+    }
+    sk::value v;
+    REQUIRE(!r.read(v));
+}
+
+TEST_CASE("value_writer batches") {
+    auto values = sample_values();
+    std::vector<std::byte> buf(4096);
+
+    sk::value_writer w(buf);
+    w.write_batch(values);
+    w.write_batch(values);
+
+    sk::value_reader r(w.data());
+    std::vector<sk::value> batch;
+    REQUIRE(r.read_batch(batch));
+    REQUIRE(batch == values);
+
+    // A batch can also be read one value at a time.
+    for (auto const &expected : values) {
+        sk::value v;
+        REQUIRE(r.read(v));
+        REQUIRE(v == expected);
+    }
+    REQUIRE(!r.read_batch(batch));
+}
+
+TEST_CASE("value_writer buffer overflow") {
+    std::vector<std::byte> buf(8);
+    sk::value_writer w(buf);
+    REQUIRE_THROWS_AS(w.write(sk::value{std::string(100, 'x')}),
+                      sk::value_format_error);
+}
+
+TEST_CASE("value_reader malformed input") {
+    std::vector<std::byte> bad{std::byte{'X'}, std::byte{'K'}, std::byte{'V'},
+                               std::byte{1}};
+    sk::value_reader r(bad);
+    sk::value v;
+    REQUIRE_THROWS_AS(r.read(v), sk::value_format_error);
+
+    std::vector<std::byte> truncated{std::byte{'S'}, std::byte{'K'},
+                                     std::byte{'V'}, std::byte{1},
+                                     std::byte{0x10}, std::byte{5}};
+    sk::value_reader r2(truncated);
+    REQUIRE_THROWS_AS(r2.read(v), sk::value_format_error);
+
+    // 300 does not fit in an unsigned char.
+    std::vector<std::byte> range{std::byte{'S'}, std::byte{'K'},
+                                 std::byte{'V'}, std::byte{1},
+                                 std::byte{0x09}, std::byte{0xAC},
+                                 std::byte{0x02}};
+    sk::value_reader r3(range);
+    REQUIRE_THROWS_AS(r3.read(v), sk::value_format_error);
+}
+
+TEST_CASE("value_writer user types") {
+    std::vector<std::byte> buf(64);
+    sk::value_writer w(buf);
+
+    REQUIRE_THROWS_AS(w.write(sk::value{point{1, 2}}), sk::value_format_error);
+
+    sk::register_value_type<point>(
+        1,
+        [](point const &p, std::string &out) {
+            out = std::to_string(p.x) + "," + std::to_string(p.y);
+        },
+        [](std::string_view s) {
+            auto comma = s.find(',');
+            return point{std::stoi(std::string(s.substr(0, comma))),
+                         std::stoi(std::string(s.substr(comma + 1)))};
+        });
+
+    w.write(sk::value{point{3, -4}});
+
+    sk::value_reader r(w.data());
+    sk::value v;
+    REQUIRE(r.read(v));
+    REQUIRE(v == point{3, -4});
+}
+
+TEST_CASE("value_writer and value_reader through a file descriptor") {
+    auto values = sample_values();
+    auto *f = std::tmpfile();
+    REQUIRE(f != nullptr);
+#ifdef _WIN32
+    int fd = _fileno(f);
+#else
+    int fd = fileno(f);
+#endif
+
+    {
+        sk::value_writer w(fd, 64);
+        for (int i = 0; i < 100; ++i)
+            w.write_batch(values);
+    }
+
+    std::rewind(f);
+
+    sk::value_reader r(fd, 64);
+    std::vector<sk::value> batch;
+    for (int i = 0; i < 100; ++i) {
+        REQUIRE(r.read_batch(batch));
+        REQUIRE(batch == values);
+    }
+    REQUIRE(!r.read_batch(batch));
+    std::fclose(f);
+}
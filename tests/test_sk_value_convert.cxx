@@ -0,0 +1,171 @@
+/*
+ * Copyright(c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license(the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third - parties to whom the Software is furnished to
+ * do so, all subject to the following :
+ *
+ * The copyright notices in the Softwareand this entire statement, including
+ * the above license grant, this restrictionand the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine - executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON - INFRINGEMENT.IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <typeinfo>
+
+#include "sk/value_convert.hxx"
+
+TEST_CASE("value_convert between numbers") {
+    REQUIRE(sk::value_convert<long>(sk::value{42}) == 42L);
+    REQUIRE(sk::value_convert<double>(sk::value{42}) == 42.0);
+    REQUIRE(sk::value_convert<int>(sk::value{42.0}) == 42);
+    REQUIRE(sk::value_convert<int>(sk::value{-7LL}) == -7);
+    REQUIRE(sk::value_convert<float>(sk::value{0.5}) == 0.5f);
+    REQUIRE(sk::value_convert<bool>(sk::value{1}) == true);
+    REQUIRE(sk::value_convert<int>(sk::value{true}) == 1);
+    REQUIRE(sk::value_convert<std::uint64_t>(sk::value{9.0e18}) ==
+            std::uint64_t(9000000000000000000));
+
+    REQUIRE_THROWS_AS(sk::value_convert<unsigned char>(sk::value{300}),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(sk::value_convert<unsigned>(sk::value{-1}),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(sk::value_convert<int>(sk::value{1.5}),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(sk::value_convert<std::int64_t>(sk::value{9.3e18}),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(sk::value_convert<int>(sk::value{
+                          std::numeric_limits<double>::quiet_NaN()}),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(sk::value_convert<float>(sk::value{1e300}),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(sk::value_convert<bool>(sk::value{2}),
+                      std::invalid_argument);
+}
+
+TEST_CASE("value_convert from integers to floating point is exact") {
+    auto const p53 = std::int64_t(1) << 53;
+    REQUIRE(sk::value_convert<double>(sk::value{p53}) == 9007199254740992.0);
+    REQUIRE(!sk::try_value_convert<double>(sk::value{p53 + 1}));
+    REQUIRE(sk::value_convert<float>(sk::value{16777216}) == 16777216.0f);
+    REQUIRE(!sk::try_value_convert<float>(sk::value{16777217}));
+    REQUIRE(sk::value_convert<float>(sk::value{-16777216}) == -16777216.0f);
+    REQUIRE(!sk::try_value_convert<float>(sk::value{-16777217}));
+
+    // These round up to 2^63 and 2^64, which do not fit in the integer.
+    REQUIRE(!sk::try_value_convert<double>(
+        sk::value{std::numeric_limits<std::int64_t>::max()}));
+    REQUIRE(!sk::try_value_convert<double>(
+        sk::value{std::numeric_limits<std::uint64_t>::max()}));
+    REQUIRE(sk::value_convert<double>(sk::value{
+                std::numeric_limits<std::int64_t>::min()}) == -0x1p63);
+
+    // Narrowing between floating point types rounds.
+    REQUIRE(sk::value_convert<float>(sk::value{0.1}) == 0.1f);
+}
+
+TEST_CASE("value_convert between numbers and strings") {
+    REQUIRE(sk::value_convert<std::string>(sk::value{42}) == "42");
+    REQUIRE(sk::value_convert<std::string>(sk::value{0.1}) == "0.1");
+    REQUIRE(sk::value_convert<std::string>(sk::value{false}) == "false");
+    REQUIRE(sk::value_convert<int>(sk::value{"-12"}) == -12);
+    REQUIRE(sk::value_convert<double>(sk::value{"2.5"}) == 2.5);
+    REQUIRE(sk::value_convert<bool>(sk::value{"true"}) == true);
+    REQUIRE(sk::value_convert<int>(sk::value::borrow("17")) == 17);
+
+    REQUIRE_THROWS_AS(sk::value_convert<int>(sk::value{"12x"}),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(sk::value_convert<int>(sk::value{""}),
+                      std::invalid_argument);
+    REQUIRE_THROWS_AS(sk::value_convert<unsigned char>(sk::value{"256"}),
+                      std::invalid_argument);
+    REQUIRE(!sk::try_value_convert<int>(sk::value{"x"}));
+    REQUIRE(sk::try_value_convert<int>(sk::value{"5"}) == 5);
+}
+
+TEST_CASE("value_convert without a conversion") {
+    REQUIRE(sk::value_convert<std::string>(sk::value{"s"}) == "s");
+    REQUIRE_THROWS_AS(sk::value_convert<int>(sk::value{}), std::bad_cast);
+    REQUIRE_THROWS_AS(sk::value_convert<int>(sk::value{'c'}), std::bad_cast);
+    REQUIRE(!sk::try_value_convert<int>(sk::value{}));
+}
+
+namespace {
+
+    struct celsius {
+        double degrees;
+        auto operator==(celsius const &) const -> bool = default;
+    };
+
+} // namespace
+
+template <> struct std::hash<celsius> {
+    auto operator()(celsius const &c) const -> std::size_t {
+        return std::hash<double>{}(c.degrees);
+    }
+};
+
+TEST_CASE("value_convert with a registered converter") {
+    REQUIRE_THROWS_AS(sk::value_convert<double>(sk::value{celsius{20}}),
+                      std::bad_cast);
+
+    sk::register_value_converter<celsius, double>(
+        [](celsius const &c, double &d) {
+            d = c.degrees;
+            return true;
+        });
+    REQUIRE(sk::value_convert<double>(sk::value{celsius{20}}) == 20.0);
+
+    // Registering again replaces the converter, and cached lookups see it.
+    sk::register_value_converter<celsius, double>(
+        [](celsius const &c, double &d) {
+            d = c.degrees * 9 / 5 + 32;
+            return true;
+        });
+    REQUIRE(sk::value_convert<double>(sk::value{celsius{20}}) == 68.0);
+
+    // Built-in conversions can be overridden too.
+    sk::register_value_converter<int, std::string>(
+        [](int const &i, std::string &s) {
+            s = "#" + std::to_string(i);
+            return true;
+        });
+    REQUIRE(sk::value_convert<std::string>(sk::value{5}) == "#5");
+    sk::register_value_converter<int, std::string>(
+        [](int const &i, std::string &s) {
+            s = std::to_string(i);
+            return true;
+        });
+}
+
+TEST_CASE("value_convert returns a value of the same type as is") {
+    REQUIRE(sk::value_convert<celsius>(sk::value{celsius{-5}}) ==
+            celsius{-5});
+    REQUIRE(sk::try_value_convert<celsius>(sk::value{celsius{-5}}) ==
+            celsius{-5});
+    REQUIRE(sk::value_convert<char>(sk::value{'a'}) == 'a');
+    REQUIRE(sk::value_convert<std::wstring>(sk::value{std::wstring(L"w")}) ==
+            L"w");
+    REQUIRE_THROWS_AS(sk::value_convert<celsius>(sk::value{1.0}),
+                      std::bad_cast);
+}
@@ -0,0 +1,204 @@
+/*
+ * Copyright(c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license(the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third - parties to whom the Software is furnished to
+ * do so, all subject to the following :
+ *
+ * The copyright notices in the Softwareand this entire statement, including
+ * the above license grant, this restrictionand the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine - executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON - INFRINGEMENT.IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <catch.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "sk/value_filter.hxx"
+
+namespace {
+
+    constexpr sk::value_compare_op all_ops[] = {
+        sk::value_compare_op::eq, sk::value_compare_op::ne,
+        sk::value_compare_op::lt, sk::value_compare_op::le,
+        sk::value_compare_op::gt, sk::value_compare_op::ge};
+
+    template <typename A, typename B>
+    auto expected(A const &cell, sk::value_compare_op op, B const &literal)
+        -> bool {
+        switch (op) {
+        case sk::value_compare_op::eq:
+            return cell == literal;
+        case sk::value_compare_op::ne:
+            return !(cell == literal);
+        case sk::value_compare_op::lt:
+            return cell < literal;
+        case sk::value_compare_op::le:
+            return !(literal < cell);
+        case sk::value_compare_op::gt:
+            return literal < cell;
+        default:
+            return !(cell < literal);
+        }
+    }
+
+    auto bit(std::vector<std::uint64_t> const &bitmap, std::size_t i) {
+        return ((bitmap[i / 64] >> (i % 64)) & 1) != 0;
+    }
+
+    void require_matches(std::vector<sk::value> const &column,
+                         sk::value const &literal) {
+        std::vector<std::uint64_t> bitmap(
+            sk::value_bitmap_words(column.size()), ~std::uint64_t(0));
+        for (auto op : all_ops) {
+            sk::compare_column(column, op, literal, bitmap);
+            for (std::size_t i = 0; i < column.size(); ++i) {
+                INFO(column[i].str() << " op " << int(op) << " "
+                                     << literal.str());
+                REQUIRE(bit(bitmap, i) == expected(column[i], op, literal));
+            }
+            // Bits past the end are clear.
+            if (column.size() % 64)
+                REQUIRE((bitmap.back() >> (column.size() % 64)) == 0);
+        }
+    }
+
+} // namespace
+
+TEST_CASE("compare_column matches value operators") {
+    std::mt19937 rng(7);
+    std::vector<sk::value> column;
+    for (int i = 0; i < 500; ++i) {
+        // Mostly runs of ints, with runs of other types mixed in.
+        switch (rng() % 10) {
+        case 0:
+            column.emplace_back(double(rng() % 20) - 10);
+            break;
+        case 1:
+            column.emplace_back(std::to_string(rng() % 20));
+            break;
+        case 2:
+            column.emplace_back();
+            break;
+        case 3:
+            column.emplace_back((long long)(rng() % 20) - 10);
+            break;
+        default:
+            for (int j = 0, n = int(rng() % 100); j < n; ++j)
+                column.emplace_back(int(rng() % 20) - 10);
+        }
+    }
+    column.push_back(sk::value::constant<3>());
+    column.push_back(sk::value::borrow("5"));
+    column.emplace_back(std::numeric_limits<double>::quiet_NaN());
+
+    require_matches(column, sk::value{3});
+    require_matches(column, sk::value{-10});
+    require_matches(column, sk::value{3.0});
+    require_matches(column, sk::value{std::numeric_limits<double>::quiet_NaN()});
+    require_matches(column, sk::value{(long long)(0)});
+    require_matches(column, sk::value{"5"});
+    require_matches(column, sk::value::constant<3>());
+    require_matches(column, sk::value{});
+    require_matches(column, sk::value{1.5f});
+    require_matches(column, sk::value{true});
+}
+
+TEST_CASE("compare_column handles short and empty columns") {
+    for (std::size_t n : {0, 1, 63, 64, 65, 128}) {
+        std::vector<sk::value> column;
+        for (std::size_t i = 0; i < n; ++i)
+            column.emplace_back(int(i));
+        require_matches(column, sk::value{int(n / 2)});
+    }
+
+    std::vector<sk::value> column(65);
+    std::vector<std::uint64_t> bitmap(1);
+    REQUIRE_THROWS_AS(sk::compare_column(column, sk::value_compare_op::eq,
+                                         sk::value{}, bitmap),
+                      std::invalid_argument);
+}
+
+TEST_CASE("compare_column on plain columns") {
+    auto check = [](auto const &column, auto literal) {
+        using T = std::remove_cvref_t<decltype(column[0])>;
+        std::vector<std::uint64_t> bitmap(
+            sk::value_bitmap_words(column.size()));
+        for (auto op : all_ops) {
+            sk::compare_column<T>(column, op, literal, bitmap);
+            for (std::size_t i = 0; i < column.size(); ++i)
+                REQUIRE(bit(bitmap, i) == expected(column[i], op, literal));
+        }
+    };
+
+    std::mt19937_64 rng(3);
+    std::vector<int> ints;
+    std::vector<long long> longs;
+    std::vector<double> doubles;
+    std::vector<unsigned> unsigneds;
+    for (int i = 0; i < 301; ++i) {
+        ints.push_back(int(rng() % 41) - 20);
+        longs.push_back((long long)(rng() % 41) - 20);
+        doubles.push_back(double(rng() % 41) / 2 - 10);
+        unsigneds.push_back(unsigned(rng() % 41));
+    }
+    doubles.push_back(std::numeric_limits<double>::quiet_NaN());
+    doubles.push_back(-0.0);
+
+    check(ints, 0);
+    check(ints, std::numeric_limits<int>::min());
+    check(longs, 7LL);
+    check(doubles, 0.0);
+    check(doubles, std::numeric_limits<double>::quiet_NaN());
+    check(unsigneds, 20u);
+    check(std::vector<std::string>{"a", "b", "c"}, std::string("b"));
+}
+
+#ifdef SK_VALUE_FILTER_X86
+TEST_CASE("compare_column kernels agree") {
+    std::mt19937_64 rng(5);
+    auto check = [&](auto zero) {
+        using K = decltype(zero);
+        K in[64];
+        for (auto &k : in)
+            k = K(rng() % 9) - K(4);
+        __builtin_cpu_init();
+        for (std::size_t n = 0; n <= 64; ++n)
+            for (auto pred : {sk::detail::value_filter_pred::eq,
+                              sk::detail::value_filter_pred::lt,
+                              sk::detail::value_filter_pred::gt}) {
+                auto want = sk::detail::value_filter_scalar<K>(in, n, K(1),
+                                                               pred);
+                if (__builtin_cpu_supports("avx2"))
+                    REQUIRE(sk::detail::value_filter_avx2(in, n, K(1), pred) ==
+                            want);
+                if (__builtin_cpu_supports("sse4.2"))
+                    REQUIRE(sk::detail::value_filter_sse42(in, n, K(1), pred) ==
+                            want);
+            }
+    };
+    check(std::int32_t(0));
+    check(std::int64_t(0));
+    check(0.0);
+}
+#endif
@@ -0,0 +1,183 @@
+/*
+ * Copyright(c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license(the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third - parties to whom the Software is furnished to
+ * do so, all subject to the following :
+ *
+ * The copyright notices in the Softwareand this entire statement, including
+ * the above license grant, this restrictionand the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine - executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON - INFRINGEMENT.IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch.hpp>
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+#include "sk/value_flat_map.hxx"
+
+namespace {
+
+    // Counts live objects, and throws from the copy constructor once the
+    // given number of copies has been made.
+    struct counted {
+        static inline int live = 0;
+        static inline int copies_left = -1;
+
+        counted() {
+            ++live;
+        }
+
+        counted(counted const &) {
+            if (copies_left == 0)
+                throw std::runtime_error("copy failed");
+            if (copies_left > 0)
+                --copies_left;
+            ++live;
+        }
+
+        ~counted() {
+            --live;
+        }
+    };
+
+} // namespace
+
+TEST_CASE("value_flat_map insert and find") {
+    sk::value_flat_map<int> m;
+
+    REQUIRE(m.empty());
+    REQUIRE(m.try_emplace(sk::value{42}, 1).second);
+    REQUIRE(m.try_emplace("foo", 2).second);
+    REQUIRE(m.try_emplace(sk::value{}, 3).second);
+    REQUIRE(!m.try_emplace(42, 4).second);
+    REQUIRE(m.size() == 3);
+
+    REQUIRE(m.at(sk::value{42}) == 1);
+    REQUIRE(m.at(42) == 1);
+    REQUIRE(m.at("foo") == 2);
+    REQUIRE(m.at(std::string_view("foo")) == 2);
+    REQUIRE(m.at(std::string("foo")) == 2);
+    REQUIRE(m.at(sk::value::borrow("foo")) == 2);
+    REQUIRE(m.at(nullptr) == 3);
+    REQUIRE(m.at(sk::value{}) == 3);
+
+    // Different types never match.
+    REQUIRE(!m.contains(42L));
+    REQUIRE(!m.contains(42.0));
+    REQUIRE(m.find(43) == m.end());
+    REQUIRE_THROWS_AS(m.at(43), std::out_of_range);
+
+    m[42] = 10;
+    REQUIRE(m.at(42) == 10);
+    m[std::string("bar")] = 11;
+    REQUIRE(m.at(sk::value{"bar"}) == 11);
+}
+
+TEST_CASE("value_flat_map growth and erase") {
+    sk::value_flat_map<int> m;
+
+    for (int i = 0; i < 10000; ++i)
+        REQUIRE(m.try_emplace(i, i * 2).second);
+    REQUIRE(m.size() == 10000);
+
+    for (int i = 0; i < 10000; ++i)
+        REQUIRE(m.at(i) == i * 2);
+
+    for (int i = 0; i < 10000; i += 2)
+        REQUIRE(m.erase(i) == 1);
+    REQUIRE(m.erase(0) == 0);
+    REQUIRE(m.size() == 5000);
+
+    for (int i = 0; i < 10000; ++i)
+        REQUIRE(m.contains(i) == (i % 2 == 1));
+
+    // Reinserting into tombstones must not lose anything.
+    for (int i = 0; i < 10000; i += 2)
+        m[i] = -i;
+    REQUIRE(m.size() == 10000);
+    for (int i = 0; i < 10000; ++i)
+        REQUIRE(m.at(i) == (i % 2 ? i * 2 : -i));
+
+    std::size_t n = 0;
+    for (auto const &[k, v] : m) {
+        REQUIRE(sk::value_cast<int>(&k) != nullptr);
+        ++n;
+    }
+    REQUIRE(n == 10000);
+}
+
+TEST_CASE("value_flat_map copy and move") {
+    sk::value_flat_map<std::string> m;
+    for (int i = 0; i < 100; ++i)
+        m[i] = std::to_string(i);
+
+    auto m2 = m;
+    REQUIRE(m2.size() == 100);
+    REQUIRE(m2.at(57) == "57");
+
+    auto m3 = std::move(m);
+    REQUIRE(m3.size() == 100);
+    REQUIRE(m3.at(99) == "99");
+
+    m3.clear();
+    REQUIRE(m3.empty());
+    REQUIRE(!m3.contains(1));
+    m3[1] = "one";
+    REQUIRE(m3.at(1) == "one");
+}
+
+TEST_CASE("value_flat_map copy which throws") {
+    {
+        sk::value_flat_map<counted> m;
+        for (int i = 0; i < 100; ++i)
+            m[i];
+        REQUIRE(counted::live == 100);
+
+        counted::copies_left = 50;
+        REQUIRE_THROWS_AS(sk::value_flat_map<counted>(m), std::runtime_error);
+        counted::copies_left = -1;
+
+        // The partial copy destroyed exactly the slots it constructed.
+        REQUIRE(counted::live == 100);
+    }
+    REQUIRE(counted::live == 0);
+}
+
+TEST_CASE("value_flat_set") {
+    sk::value_flat_set s;
+
+    REQUIRE(s.insert(1).second);
+    REQUIRE(s.insert("one").second);
+    REQUIRE(s.insert(1.0).second);
+    REQUIRE(!s.insert(sk::value{1}).second);
+    REQUIRE(!s.insert(std::string("one")).second);
+    REQUIRE(s.size() == 3);
+
+    REQUIRE(s.contains(1));
+    REQUIRE(s.contains("one"));
+    REQUIRE(s.contains(1.0));
+    REQUIRE(!s.contains(2));
+
+    REQUIRE(s.erase("one") == 1);
+    REQUIRE(!s.contains("one"));
+    REQUIRE(s.size() == 2);
+}
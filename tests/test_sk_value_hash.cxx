@@ -0,0 +1,151 @@
+/*
+ * Copyright(c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license(the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third - parties to whom the Software is furnished to
+ * do so, all subject to the following :
+ *
+ * The copyright notices in the Softwareand this entire statement, including
+ * the above license grant, this restrictionand the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine - executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON - INFRINGEMENT.IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+#include <catch.hpp>
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "sk/value_hash.hxx"
+
+namespace {
+
+    auto hashes(std::vector<sk::value> const &values) {
+        std::vector<std::uint64_t> out(values.size());
+        sk::hash_values(values, out);
+        return out;
+    }
+
+    void require_std_hashes(std::vector<sk::value> const &values) {
+        auto out = hashes(values);
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            INFO(i << ": " << values[i].str());
+            REQUIRE(out[i] == std::hash<sk::value>{}(values[i]));
+        }
+    }
+
+    auto random_doubles(std::size_t n) {
+        std::mt19937_64 rng(42);
+        std::vector<double> doubles;
+        for (std::size_t i = 0; i < n; ++i)
+            doubles.push_back(std::bit_cast<double>(rng()));
+        auto inf = std::numeric_limits<double>::infinity();
+        for (double d : {0.0, -0.0, 1.0, -1.0, inf, -inf,
+                         std::numeric_limits<double>::quiet_NaN(),
+                         std::numeric_limits<double>::denorm_min()})
+            doubles.push_back(d);
+        return doubles;
+    }
+
+} // namespace
+
+TEST_CASE("hash_values matches std::hash for mixed values") {
+    std::vector<sk::value> values;
+    values.emplace_back();
+    values.emplace_back(1.5);
+    values.emplace_back(0.0);
+    values.emplace_back(-0.0);
+    values.emplace_back(42);
+    values.emplace_back(-42);
+    values.emplace_back(std::int64_t(-1));
+    values.emplace_back(std::uint64_t(1) << 63);
+    values.emplace_back(short(-3));
+    values.emplace_back('c');
+    values.emplace_back(true);
+    values.emplace_back("foo");
+    values.push_back(sk::value::borrow("bar"));
+    values.push_back(sk::value::constant<"baz">());
+    values.push_back(sk::value::constant<7>());
+    values.emplace_back(2.5f);
+    values.emplace_back(std::u8string(u8"x"));
+    values.emplace_back("");
+    require_std_hashes(values);
+}
+
+TEST_CASE("hash_values matches std::hash for long runs") {
+    std::vector<sk::value> values;
+    for (double d : random_doubles(300))
+        values.emplace_back(d);
+    for (int i = -150; i < 150; ++i)
+        values.emplace_back(i * 7919);
+    for (int i = 0; i < 150; ++i)
+        values.emplace_back(std::to_string(i));
+    for (int i = 0; i < 150; ++i) {
+        values.emplace_back(i * 0.25);
+        values.emplace_back(std::int64_t(i) << 40);
+    }
+    require_std_hashes(values);
+}
+
+TEST_CASE("hash_column matches sk::value hashes") {
+    auto doubles = random_doubles(1000);
+    std::vector<std::uint64_t> out(doubles.size());
+    sk::hash_column<double>(doubles, out);
+    for (std::size_t i = 0; i < doubles.size(); ++i)
+        REQUIRE(out[i] == std::hash<sk::value>{}(sk::value{doubles[i]}));
+
+    std::vector<int> ints{0, 1, -1, std::numeric_limits<int>::min(),
+                          std::numeric_limits<int>::max()};
+    out.resize(ints.size());
+    sk::hash_column<int>(ints, out);
+    for (std::size_t i = 0; i < ints.size(); ++i)
+        REQUIRE(out[i] == std::hash<sk::value>{}(sk::value{ints[i]}));
+
+    out.resize(1);
+    REQUIRE_THROWS_AS(sk::hash_column<int>(ints, out), std::invalid_argument);
+}
+
+#ifdef SK_VALUE_HASH_X86
+TEST_CASE("hash_values double kernels agree") {
+    auto doubles = random_doubles(1001);
+    std::vector<std::uint64_t> expected(doubles.size()), out(doubles.size());
+    sk::detail::value_hash_doubles_std(doubles.data(), expected.data(),
+                                       doubles.size());
+
+    sk::detail::value_hash_doubles_scalar(doubles.data(), out.data(),
+                                          doubles.size());
+    REQUIRE(out == expected);
+
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse4.2")) {
+        sk::detail::value_hash_doubles_sse42(doubles.data(), out.data(),
+                                             doubles.size());
+        REQUIRE(out == expected);
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        sk::detail::value_hash_doubles_avx2(doubles.data(), out.data(),
+                                            doubles.size());
+        REQUIRE(out == expected);
+    }
+}
+#endif
@@ -0,0 +1,137 @@
+/*
+ * Copyright(c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license(the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third - parties to whom the Software is furnished to
+ * do so, all subject to the following :
+ *
+ * The copyright notices in the Softwareand this entire statement, including
+ * the above license grant, this restrictionand the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine - executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON - INFRINGEMENT.IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "sk/value_json.hxx"
+
+TEST_CASE("write_json scalars") {
+    REQUIRE(sk::to_json(sk::value{}) == "null");
+    REQUIRE(sk::to_json(sk::value{true}) == "true");
+    REQUIRE(sk::to_json(sk::value{false}) == "false");
+    REQUIRE(sk::to_json(sk::value{42}) == "42");
+    REQUIRE(sk::to_json(sk::value{-7LL}) == "-7");
+    REQUIRE(sk::to_json(sk::value{42u}) == "42");
+    REQUIRE(sk::to_json(sk::value{1.5}) == "1.5");
+    REQUIRE(sk::to_json(sk::value{0.1}) == "0.1");
+    REQUIRE(sk::to_json(sk::value{1.0}) == "1.0");
+    REQUIRE(sk::to_json(sk::value{-100.0}) == "-100.0");
+    REQUIRE(sk::to_json(sk::value{2.0f}) == "2.0");
+    REQUIRE(sk::to_json(sk::value{1e300}) == "1e+300");
+    REQUIRE(sk::to_json(sk::value{std::numeric_limits<double>::infinity()}) ==
+            "null");
+    REQUIRE(sk::to_json(sk::value{"foo"}) == "\"foo\"");
+    REQUIRE(sk::to_json(sk::value::borrow("bar")) == "\"bar\"");
+    REQUIRE(sk::to_json(sk::value{'c'}) == "\"c\"");
+}
+
+TEST_CASE("write_json escapes strings") {
+    using namespace std::string_literals;
+    REQUIRE(sk::to_json(sk::value{"a\"b\\c"}) == R"("a\"b\\c")");
+    REQUIRE(sk::to_json(sk::value{"line\nnext\ttab"}) ==
+            R"("line\nnext\ttab")");
+    REQUIRE(sk::to_json(sk::value{"\x01"s}) == R"("\u0001")");
+    REQUIRE(sk::to_json(sk::value{"\0"s}) == R"("\u0000")");
+
+    // Long strings exercise the 16-byte scanner.
+    std::string long_string(100, 'x');
+    long_string[37] = '"';
+    long_string[70] = '\x1f';
+    auto json = sk::to_json(sk::value{long_string});
+    REQUIRE(json.size() == long_string.size() + 2 + 1 + 5);
+    REQUIRE(sk::parse_json(json) == long_string);
+
+    // UTF-8 passes through unchanged.
+    REQUIRE(sk::to_json(sk::value{"caf\xC3\xA9"}) == "\"caf\xC3\xA9\"");
+}
+
+TEST_CASE("write_json arrays") {
+    std::vector<sk::value> row;
+    row.emplace_back(1);
+    row.emplace_back();
+    row.emplace_back("x");
+
+    std::string out;
+    sk::write_json(row, out);
+    REQUIRE(out == R"([1,null,"x"])");
+
+    out.clear();
+    sk::write_json(std::span<sk::value const>(), out);
+    REQUIRE(out == "[]");
+}
+
+TEST_CASE("parse_json scalars") {
+    REQUIRE(sk::parse_json("null").empty());
+    REQUIRE(sk::parse_json(" true ") == true);
+    REQUIRE(sk::parse_json("false") == false);
+    REQUIRE(sk::parse_json("42") == std::int64_t(42));
+    REQUIRE(sk::parse_json("-42") == std::int64_t(-42));
+    REQUIRE(sk::parse_json("1.5") == 1.5);
+    REQUIRE(sk::parse_json("1e2") == 100.0);
+    REQUIRE(sk::parse_json("1E+2") == 100.0);
+    REQUIRE(sk::parse_json("99999999999999999999") == 1e20);
+    REQUIRE(sk::parse_json(R"("a\"b\\c\/\n")") == "a\"b\\c/\n");
+    REQUIRE(sk::parse_json(R"("\u00e9")") == "\xC3\xA9");
+    REQUIRE(sk::parse_json(R"("\ud83d\ude00")") == "\xF0\x9F\x98\x80");
+
+    // Integral doubles are written with a fraction and read back as doubles.
+    auto whole = sk::parse_json(sk::to_json(sk::value{-3.0}));
+    REQUIRE(sk::value_cast<double>(&whole) != nullptr);
+    REQUIRE(whole == -3.0);
+}
+
+TEST_CASE("parse_json arrays") {
+    std::vector<sk::value> out;
+    sk::parse_json_array(R"( [1, "two", null, 3.5, true] )", out);
+    REQUIRE(out.size() == 5);
+    REQUIRE(out[0] == std::int64_t(1));
+    REQUIRE(out[1] == "two");
+    REQUIRE(out[2].empty());
+    REQUIRE(out[3] == 3.5);
+    REQUIRE(out[4] == true);
+
+    out.clear();
+    sk::parse_json_array("[]", out);
+    REQUIRE(out.empty());
+}
+
+TEST_CASE("parse_json errors") {
+    std::vector<sk::value> out;
+    for (auto bad : {"", "nul", "01", "01x", "-", "1.", "\"abc", "\"\\x\"",
+                     "\"\\ud800\"", "{}", "[1]", "1 2", "\"a\nb\""})
+        REQUIRE_THROWS_AS(sk::parse_json(bad), sk::value_format_error);
+
+    for (auto bad : {"[1,", "[1 2]", "[[1]]", "1", "[1,]"})
+        REQUIRE_THROWS_AS(sk::parse_json_array(bad, out),
+                          sk::value_format_error);
+}
@@ -0,0 +1,115 @@
+/*
+ * Copyright(c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license(the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third - parties to whom the Software is furnished to
+ * do so, all subject to the following :
+ *
+ * The copyright notices in the Softwareand this entire statement, including
+ * the above license grant, this restrictionand the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine - executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON - INFRINGEMENT.IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "sk/value_key.hxx"
+
+namespace {
+
+    template <typename T> void require_key_order(std::vector<T> const &sorted) {
+        for (std::size_t i = 0; i < sorted.size(); ++i) {
+            sk::value v{sorted[i]};
+            auto key = sk::encode_key(v);
+            REQUIRE(sk::decode_key(key) == v);
+
+            if (i > 0)
+                REQUIRE(sk::encode_key(sk::value{sorted[i - 1]}) < key);
+        }
+    }
+
+} // namespace
+
+TEST_CASE("encode_key integers") {
+    require_key_order<int>({std::numeric_limits<int>::min(), -1000, -1, 0, 1,
+                            255, 256, std::numeric_limits<int>::max()});
+    require_key_order<long long>(
+        {std::numeric_limits<long long>::min(), -1, 0, 1LL << 40,
+         std::numeric_limits<long long>::max()});
+    require_key_order<unsigned>({0u, 1u, 255u, 256u, 0xFFFFFFFFu});
+    require_key_order<signed char>({-128, -1, 0, 127});
+}
+
+TEST_CASE("encode_key floating point") {
+    auto inf = std::numeric_limits<double>::infinity();
+    require_key_order<double>({-inf, -1e300, -1.5, -1e-300, 0.0, 1e-300, 1.5,
+                               1e300, inf});
+    require_key_order<float>({-1.0f, 0.0f, 0.5f, 2.0f});
+
+    REQUIRE(sk::encode_key(sk::value{-0.0}) < sk::encode_key(sk::value{0.0}));
+}
+
+TEST_CASE("encode_key strings") {
+    using namespace std::string_literals;
+    require_key_order<std::string>(
+        {""s, "\0"s, "\0\0"s, "\0a"s, "a"s, "a\0"s, "a\0b"s, "ab"s, "b"s,
+         "\xFF"s});
+}
+
+TEST_CASE("encode_key empty and bool") {
+    auto empty = sk::encode_key(sk::value{});
+    REQUIRE(sk::decode_key(empty).empty());
+    REQUIRE(empty < sk::encode_key(sk::value{false}));
+    REQUIRE(empty < sk::encode_key(sk::value{std::string()}));
+    REQUIRE(sk::encode_key(sk::value{false}) < sk::encode_key(sk::value{true}));
+    REQUIRE(sk::decode_key(sk::encode_key(sk::value{true})) == true);
+}
+
+TEST_CASE("encode_key tuples") {
+    std::vector<sk::value> a, b, c;
+    a.emplace_back("x");
+    a.emplace_back(1);
+    b.emplace_back("x");
+    b.emplace_back(2);
+    c.emplace_back("x");
+
+    auto ka = sk::encode_key(a), kb = sk::encode_key(b),
+         kc = sk::encode_key(c);
+    REQUIRE(ka < kb);
+    REQUIRE(kc < ka);
+
+    auto decoded = sk::decode_key_tuple(kb);
+    REQUIRE(decoded.size() == 2);
+    REQUIRE(decoded[0] == "x");
+    REQUIRE(decoded[1] == 2);
+}
+
+TEST_CASE("encode_key errors") {
+    REQUIRE_THROWS_AS(sk::encode_key(sk::value{std::wstring(L"x")}),
+                      sk::value_format_error);
+    REQUIRE_THROWS_AS(sk::decode_key(""), sk::value_format_error);
+    REQUIRE_THROWS_AS(sk::decode_key("\x24\x80"), sk::value_format_error);
+    REQUIRE_THROWS_AS(sk::decode_key("\x50" "abc"), sk::value_format_error);
+    REQUIRE_THROWS_AS(sk::decode_key("\x7F"), sk::value_format_error);
+}
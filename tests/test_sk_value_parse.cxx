@@ -0,0 +1,109 @@
+/*
+ * Copyright(c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license(the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third - parties to whom the Software is furnished to
+ * do so, all subject to the following :
+ *
+ * The copyright notices in the Softwareand this entire statement, including
+ * the above license grant, this restrictionand the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine - executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON - INFRINGEMENT.IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch.hpp>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "sk/value_parse.hxx"
+
+TEST_CASE("parse_value type inference") {
+    REQUIRE(sk::parse_value("").empty());
+    REQUIRE(sk::parse_value("42") == std::int64_t(42));
+    REQUIRE(sk::parse_value("-42") == std::int64_t(-42));
+    REQUIRE(sk::parse_value("+42") == std::int64_t(42));
+    REQUIRE(sk::parse_value("1.5") == 1.5);
+    REQUIRE(sk::parse_value("-1e3") == -1000.0);
+    REQUIRE(sk::parse_value(".5") == 0.5);
+    REQUIRE(sk::parse_value("true") == true);
+    REQUIRE(sk::parse_value("FALSE") == false);
+    REQUIRE(sk::parse_value("truex") == "truex");
+    REQUIRE(sk::parse_value("42abc") == "42abc");
+    REQUIRE(sk::parse_value("+") == "+");
+    REQUIRE(sk::parse_value("+-1") == "+-1");
+    REQUIRE(sk::parse_value("hello") == "hello");
+
+    // Non-finite spellings are strings whether or not they are signed.
+    for (auto text : {"inf", "-inf", "+inf", "INF", "infinity", "-Infinity",
+                      "nan", "-nan", "+nan", "NaN", "nan(1)"})
+        REQUIRE(sk::parse_value(text) == std::string(text));
+
+    // Too big for int64.
+    REQUIRE(sk::parse_value("99999999999999999999") == 99999999999999999999.0);
+}
+
+TEST_CASE("parse_value options") {
+    sk::value_parse_options opts;
+    opts.null_text = "NULL";
+    REQUIRE(sk::parse_value("NULL", opts).empty());
+    REQUIRE(sk::parse_value("", opts) == "");
+
+    opts.integers = false;
+    REQUIRE(sk::parse_value("42", opts) == 42.0);
+
+    opts.floats = false;
+    opts.bools = false;
+    REQUIRE(sk::parse_value("42", opts) == "42");
+    REQUIRE(sk::parse_value("true", opts) == "true");
+}
+
+TEST_CASE("parse_column settles on one type") {
+    std::vector<sk::value> out;
+
+    std::vector<std::string_view> ints{"1", "", "3"};
+    REQUIRE(sk::parse_column(ints, out) == sk::value_parse_kind::integer);
+    REQUIRE(out.size() == 3);
+    REQUIRE(out[0] == std::int64_t(1));
+    REQUIRE(out[1].empty());
+
+    out.clear();
+    std::vector<std::string_view> nums{"1", "2.5", ""};
+    REQUIRE(sk::parse_column(nums, out) == sk::value_parse_kind::floating);
+    REQUIRE(out[0] == 1.0);
+    REQUIRE(out[1] == 2.5);
+    REQUIRE(out[2].empty());
+
+    out.clear();
+    std::vector<std::string_view> mixed{"1", "true", "x"};
+    REQUIRE(sk::parse_column(mixed, out) == sk::value_parse_kind::string);
+    REQUIRE(out[0] == "1");
+    REQUIRE(out[1] == "true");
+
+    out.clear();
+    std::vector<std::string_view> bools{"true", "False"};
+    REQUIRE(sk::parse_column(bools, out) == sk::value_parse_kind::boolean);
+    REQUIRE(out[1] == false);
+
+    out.clear();
+    std::vector<std::string_view> empties{"", ""};
+    REQUIRE(sk::parse_column(empties, out) == sk::value_parse_kind::empty);
+    REQUIRE(out.size() == 2);
+}
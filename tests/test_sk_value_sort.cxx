@@ -0,0 +1,135 @@
+/*
+ * Copyright(c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license(the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third - parties to whom the Software is furnished to
+ * do so, all subject to the following :
+ *
+ * The copyright notices in the Softwareand this entire statement, including
+ * the above license grant, this restrictionand the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine - executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON - INFRINGEMENT.IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch.hpp>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "sk/value_sort.hxx"
+
+namespace {
+
+    struct unlisted {
+        int n;
+        auto operator==(unlisted const &) const -> bool = default;
+        auto operator<(unlisted const &other) const -> bool {
+            return n < other.n;
+        }
+    };
+
+} // namespace
+
+template <> struct std::hash<unlisted> {
+    auto operator()(unlisted const &u) const -> std::size_t {
+        return std::hash<int>{}(u.n);
+    }
+};
+
+TEST_CASE("sort_values matches operator<") {
+    std::vector<sk::value> values;
+    std::mt19937 rng(1);
+
+    for (int i = 0; i < 200; ++i) {
+        switch (rng() % 6) {
+        case 0:
+            values.emplace_back();
+            break;
+        case 1:
+            values.emplace_back(static_cast<int>(rng() % 100) - 50);
+            break;
+        case 2:
+            values.emplace_back(static_cast<double>(rng() % 100) / 3);
+            break;
+        case 3:
+            values.emplace_back(std::to_string(rng() % 1000));
+            break;
+        case 4:
+            values.emplace_back(static_cast<long>(rng() % 100));
+            break;
+        case 5:
+            values.emplace_back(unlisted{static_cast<int>(rng() % 100)});
+            break;
+        }
+    }
+
+    auto expected = values;
+    std::sort(expected.begin(), expected.end());
+
+    sk::sort_values(values);
+
+    REQUIRE(std::is_sorted(values.begin(), values.end()));
+    REQUIRE(values.size() == expected.size());
+    for (std::size_t i = 0; i < values.size(); ++i)
+        REQUIRE(values[i] == expected[i]);
+}
+
+TEST_CASE("sort_values single type") {
+    std::vector<sk::value> values;
+    for (int i = 10; i > 0; --i)
+        values.emplace_back(std::to_string(i));
+
+    sk::sort_values(values);
+    REQUIRE(values.front() == "1");
+    REQUIRE(values[1] == "10");
+    REQUIRE(values.back() == "9");
+}
+
+TEST_CASE("sort_values empty values first") {
+    std::vector<sk::value> values;
+    values.emplace_back(1);
+    values.emplace_back();
+    values.emplace_back("x");
+    values.emplace_back();
+
+    sk::sort_values(values);
+    REQUIRE(values[0].empty());
+    REQUIRE(values[1].empty());
+    REQUIRE(!values[2].empty());
+    REQUIRE(!values[3].empty());
+}
+
+TEST_CASE("sort_values compares wide strings without copying") {
+    static_assert(std::same_as<decltype(sk::detail::value_sort_object<
+                                        std::wstring>(sk::value{})),
+                               std::wstring const &>);
+    static_assert(std::same_as<decltype(sk::detail::value_sort_object<
+                                        std::string>(sk::value{})),
+                               std::string_view>);
+
+    std::vector<sk::value> values;
+    for (int i = 10; i > 0; --i)
+        values.emplace_back(std::to_wstring(i));
+
+    sk::sort_values(values);
+    REQUIRE(values.front() == std::wstring(L"1"));
+    REQUIRE(values[1] == std::wstring(L"10"));
+    REQUIRE(values.back() == std::wstring(L"9"));
+}
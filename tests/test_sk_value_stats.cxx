@@ -0,0 +1,136 @@
+/*
+ * Copyright(c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license(the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third - parties to whom the Software is furnished to
+ * do so, all subject to the following :
+ *
+ * The copyright notices in the Softwareand this entire statement, including
+ * the above license grant, this restrictionand the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine - executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON - INFRINGEMENT.IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+
+#include <string>
+#include <thread>
+#include <typeindex>
+
+#include "sk/value.hxx"
+#include "sk/value_json.hxx"
+
+namespace {
+
+    template <typename T> auto stats_for(sk::value_stats_report const &r) {
+        auto it =
+            r.by_type.find(std::type_index(typeid(sk::value_instance<T>)));
+        return it == r.by_type.end() ? sk::value_stats{} : it->second;
+    }
+
+} // namespace
+
+TEST_CASE("value_stats counts constructions, copies and moves") {
+    sk::value_stats_reset();
+
+    sk::value a(42);
+    sk::value b(a);
+    sk::value c(std::move(b));
+    c = a;
+
+    auto r = sk::value_stats_snapshot();
+    auto s = stats_for<int>(r);
+    REQUIRE(s.constructions == 3);
+    REQUIRE(s.allocations == 3);
+    REQUIRE(s.copies == 2);
+    REQUIRE(s.moves == 1);
+    REQUIRE(r.total.constructions == 3);
+}
+
+TEST_CASE("value_stats counts comparisons, hashes and strings") {
+    sk::value a(std::string("x")), b(std::string("y"));
+    sk::value_stats_reset();
+
+    REQUIRE(a != b);
+    REQUIRE(a < b);
+    REQUIRE(a == "x");
+    (void)std::hash<sk::value>{}(a);
+    REQUIRE(a.str() == "x");
+
+    auto s = stats_for<std::string>(sk::value_stats_snapshot());
+    REQUIRE(s.comparisons == 3);
+    REQUIRE(s.hashes == 1);
+    REQUIRE(s.string_conversions == 1);
+    REQUIRE(s.constructions == 0);
+}
+
+TEST_CASE("value_stats counts failed casts against the stored type") {
+    sk::value v(1.5);
+    sk::value_stats_reset();
+
+    REQUIRE(sk::value_cast<int>(&v) == nullptr);
+    REQUIRE_THROWS_AS(sk::value_cast<std::string>(v), std::bad_cast);
+    REQUIRE(sk::value_cast<double>(v) == 1.5);
+
+    auto s = stats_for<double>(sk::value_stats_snapshot());
+    REQUIRE(s.failed_casts == 2);
+}
+
+TEST_CASE("value_stats does not count the library's own type probes") {
+    sk::value v(std::string("x"));
+    sk::value_stats_reset();
+
+    REQUIRE(sk::to_json(v) == "\"x\"");
+    REQUIRE(!(v == 1));
+
+    auto s = stats_for<std::string>(sk::value_stats_snapshot());
+    REQUIRE(s.failed_casts == 0);
+}
+
+TEST_CASE("value_stats does not count constants as allocations") {
+    sk::value_stats_reset();
+
+    auto v = sk::value::constant<"abc">();
+    REQUIRE(v == "abc");
+
+    auto s = stats_for<std::string>(sk::value_stats_snapshot());
+    REQUIRE(s.allocations == 0);
+}
+
+TEST_CASE("value_stats counters are per thread") {
+    sk::value_stats_reset();
+
+    std::thread t([] {
+        for (int i = 0; i < 10; ++i)
+            sk::value v(i);
+        REQUIRE(stats_for<int>(sk::value_stats_snapshot()).constructions ==
+                10);
+    });
+    t.join();
+
+    REQUIRE(stats_for<int>(sk::value_stats_snapshot()).constructions == 0);
+}
+
+TEST_CASE("value_stats_reset clears the counters") {
+    sk::value v(1);
+    REQUIRE(sk::value_stats_snapshot().total.constructions > 0);
+
+    sk::value_stats_reset();
+    REQUIRE(sk::value_stats_snapshot().total == sk::value_stats{});
+}
@@ -0,0 +1,140 @@
+/*
+ * Copyright(c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license(the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third - parties to whom the Software is furnished to
+ * do so, all subject to the following :
+ *
+ * The copyright notices in the Softwareand this entire statement, including
+ * the above license grant, this restrictionand the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine - executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON - INFRINGEMENT.IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch.hpp>
+
+#include <string>
+#include <vector>
+
+#include "sk/value_view.hxx"
+
+namespace {
+
+    auto encode(std::vector<sk::value> const &values)
+        -> std::vector<std::byte> {
+        std::vector<std::byte> buf(4096);
+        sk::value_writer w(buf);
+        w.write_batch(values);
+        auto data = w.data();
+        return {data.begin(), data.end()};
+    }
+
+    auto views(std::vector<std::byte> const &buf)
+        -> std::vector<sk::value_view> {
+        sk::value_view_cursor c(buf);
+        std::vector<sk::value_view> r;
+        sk::value_view v;
+        while (c.next(v))
+            r.push_back(v);
+        return r;
+    }
+
+} // namespace
+
+TEST_CASE("value_view matches the decoded values") {
+    std::vector<sk::value> values;
+    values.emplace_back();
+    values.emplace_back(true);
+    values.emplace_back(false);
+    values.emplace_back('x');
+    values.emplace_back(-42);
+    values.emplace_back(42u);
+    values.emplace_back(-7LL);
+    values.emplace_back(2.5);
+    values.emplace_back(0.25f);
+    values.emplace_back("foo");
+    values.emplace_back("");
+
+    auto buf = encode(values);
+    auto vs = views(buf);
+    REQUIRE(vs.size() == values.size());
+
+    for (std::size_t i = 0; i < values.size(); ++i) {
+        auto const &v = values[i];
+        auto const &view = vs[i];
+
+        REQUIRE(view.empty() == v.empty());
+        REQUIRE(view == v);
+        REQUIRE(v == view);
+        REQUIRE(view == view);
+        REQUIRE(view.materialize() == v);
+        REQUIRE(view.str() == v.str());
+        REQUIRE(std::hash<sk::value_view>{}(view) ==
+                std::hash<sk::value>{}(v));
+        REQUIRE(view.type() == typeid(*v.object));
+
+        for (std::size_t j = 0; j < values.size(); ++j) {
+            REQUIRE((view < vs[j]) == (v < values[j]));
+            REQUIRE((view < values[j]) == (v < values[j]));
+            REQUIRE((values[j] < view) == (values[j] < v));
+            REQUIRE((view == vs[j]) == (v == values[j]));
+        }
+    }
+}
+
+TEST_CASE("value_view typed access") {
+    std::vector<sk::value> values;
+    values.emplace_back("hello");
+    values.emplace_back(3);
+    values.emplace_back(false);
+
+    auto buf = encode(values);
+    auto vs = views(buf);
+
+    std::string_view s = vs[0].get<std::string>();
+    REQUIRE(s == "hello");
+    // The string is read in place.
+    REQUIRE(reinterpret_cast<std::byte const *>(s.data()) > buf.data());
+    REQUIRE(reinterpret_cast<std::byte const *>(s.data()) <
+            buf.data() + buf.size());
+
+    REQUIRE(vs[1].get<int>() == 3);
+    REQUIRE(!vs[1].get_if<long>());
+    REQUIRE_THROWS_AS(vs[1].get<std::string>(), std::bad_cast);
+    REQUIRE(vs[2].get_if<bool>() == false);
+    REQUIRE(!vs[2].get_if<int>());
+}
+
+TEST_CASE("value_view parse") {
+    std::vector<std::byte> buf(64);
+    sk::value_writer w(buf);
+    w.write(sk::value{"abc"});
+    w.write(sk::value{1.5});
+
+    auto data = w.data().subspan(4);
+    auto a = sk::value_view::parse(data);
+    auto b = sk::value_view::parse(data);
+    REQUIRE(data.empty());
+    REQUIRE(a == sk::value{"abc"});
+    REQUIRE(b == sk::value{1.5});
+    REQUIRE(sk::value_view(b.encoded()) == b);
+
+    std::vector<std::byte> bad{std::byte{0x10}, std::byte{10}, std::byte{'a'}};
+    std::span<std::byte const> bad_span(bad);
+    REQUIRE_THROWS_AS(sk::value_view::parse(bad_span), sk::value_format_error);
+}
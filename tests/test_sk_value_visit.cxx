@@ -0,0 +1,94 @@
+/*
+ * Copyright(c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license(the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third - parties to whom the Software is furnished to
+ * do so, all subject to the following :
+ *
+ * The copyright notices in the Softwareand this entire statement, including
+ * the above license grant, this restrictionand the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine - executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON - INFRINGEMENT.IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch.hpp>
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <variant>
+
+#include "sk/value_visit.hxx"
+
+namespace {
+
+    template <typename... Fs> struct overloaded : Fs... {
+        using Fs::operator()...;
+    };
+    template <typename... Fs> overloaded(Fs...) -> overloaded<Fs...>;
+
+    using types = sk::value_types<int, double, std::string_view>;
+
+    auto describe(sk::value const &v) -> std::string {
+        return sk::visit<types>(
+            v, overloaded{
+                   [](int i) { return "int " + std::to_string(i); },
+                   [](double d) { return "double " + std::to_string(int(d)); },
+                   [](std::string_view s) {
+                       return "string " + std::string(s);
+                   },
+                   [](std::monostate) { return std::string("empty"); },
+                   [](sk::value const &v) { return "other " + v.str(); },
+               });
+    }
+
+} // namespace
+
+TEST_CASE("visit dispatches on the stored type") {
+    REQUIRE(describe(sk::value{42}) == "int 42");
+    REQUIRE(describe(sk::value{2.0}) == "double 2");
+    REQUIRE(describe(sk::value{"foo"}) == "string foo");
+    REQUIRE(describe(sk::value::borrow("bar")) == "string bar");
+    REQUIRE(describe(sk::value{}) == "empty");
+    REQUIRE(describe(sk::value{42L}) == "other 42");
+}
+
+TEST_CASE("visit without an empty case") {
+    auto v = sk::value{};
+    auto r = sk::visit<sk::value_types<std::string>>(
+        v, overloaded{[](std::string const &) { return 1; },
+                      [](sk::value const &) { return 2; }});
+    REQUIRE(r == 2);
+
+    auto b = sk::value::borrow("x");
+    r = sk::visit<sk::value_types<std::string>>(
+        b, overloaded{[](std::string const &s) { return s == "x" ? 1 : 3; },
+                      [](sk::value const &) { return 2; }});
+    REQUIRE(r == 1);
+}
+
+TEST_CASE("visit with a generic visitor") {
+    int seen = 0;
+    auto visitor = [&](auto const &x) {
+        using T = std::remove_cvref_t<decltype(x)>;
+        if constexpr (std::is_same_v<T, short>)
+            seen = x;
+    };
+    sk::visit<sk::value_types<short, int>>(sk::value{short(3)}, visitor);
+    REQUIRE(seen == 3);
+}
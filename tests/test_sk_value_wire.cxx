@@ -0,0 +1,230 @@
+/*
+ * Copyright(c) 2019, 2020, 2021 SiKol Ltd.
+ *
+ * Boost Software License - Version 1.0 - August 17th, 2003
+ *
+ * Permission is hereby granted, free of charge, to any person or organization
+ * obtaining a copy of the software and accompanying documentation covered by
+ * this license(the "Software") to use, reproduce, display, distribute,
+ * execute, and transmit the Software, and to prepare derivative works of the
+ * Software, and to permit third - parties to whom the Software is furnished to
+ * do so, all subject to the following :
+ *
+ * The copyright notices in the Softwareand this entire statement, including
+ * the above license grant, this restrictionand the following disclaimer,
+ * must be included in all copies of the Software, in whole or in part, and
+ * all derivative works of the Software, unless such copies or derivative
+ * works are solely in the form of machine - executable object code generated by
+ * a source language processor.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE, TITLE AND NON - INFRINGEMENT.IN NO EVENT
+ * SHALL THE COPYRIGHT HOLDERS OR ANYONE DISTRIBUTING THE SOFTWARE BE LIABLE
+ * FOR ANY DAMAGES OR OTHER LIABILITY, WHETHER IN CONTRACT, TORT OR OTHERWISE,
+ * ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <catch.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "sk/value_wire.hxx"
+
+namespace {
+
+    template <typename Writer>
+    auto encode(sk::value const &v) -> std::vector<unsigned char> {
+        std::byte buf[128];
+        Writer w(buf);
+        w.write(v);
+        auto d = w.data();
+        auto const *p = reinterpret_cast<unsigned char const *>(d.data());
+        return {p, p + d.size()};
+    }
+
+    template <typename Writer, typename Reader>
+    auto round_trip(sk::value const &v,
+                    sk::value_wire_strings strings = sk::value_wire_strings::copy)
+        -> sk::value {
+        std::byte buf[128];
+        Writer w(buf);
+        w.write(v);
+        Reader r(w.data(), strings);
+        sk::value out;
+        REQUIRE(r.read(out));
+        REQUIRE(r.at_end());
+        return out;
+    }
+
+    using bytes = std::vector<unsigned char>;
+
+} // namespace
+
+TEST_CASE("msgpack_writer uses the smallest encoding") {
+    using W = sk::msgpack_writer;
+    REQUIRE(encode<W>(sk::value{}) == bytes{0xC0});
+    REQUIRE(encode<W>(sk::value{true}) == bytes{0xC3});
+    REQUIRE(encode<W>(sk::value{false}) == bytes{0xC2});
+    REQUIRE(encode<W>(sk::value{5}) == bytes{0x05});
+    REQUIRE(encode<W>(sk::value{-1}) == bytes{0xFF});
+    REQUIRE(encode<W>(sk::value{-33}) == bytes{0xD0, 0xDF});
+    REQUIRE(encode<W>(sk::value{200u}) == bytes{0xCC, 0xC8});
+    REQUIRE(encode<W>(sk::value{1000}) == bytes{0xCD, 0x03, 0xE8});
+    REQUIRE(encode<W>(sk::value{-1000L}) == bytes{0xD1, 0xFC, 0x18});
+    REQUIRE(encode<W>(sk::value{1.0f}) == bytes{0xCA, 0x3F, 0x80, 0, 0});
+    REQUIRE(encode<W>(sk::value{1.0}) ==
+            bytes{0xCB, 0x3F, 0xF0, 0, 0, 0, 0, 0, 0});
+    REQUIRE(encode<W>(sk::value{"ab"}) == bytes{0xA2, 'a', 'b'});
+    REQUIRE(encode<W>(sk::value::borrow("ab")) == bytes{0xA2, 'a', 'b'});
+}
+
+TEST_CASE("cbor_writer uses the smallest encoding") {
+    using W = sk::cbor_writer;
+    REQUIRE(encode<W>(sk::value{}) == bytes{0xF6});
+    REQUIRE(encode<W>(sk::value{true}) == bytes{0xF5});
+    REQUIRE(encode<W>(sk::value{10}) == bytes{0x0A});
+    REQUIRE(encode<W>(sk::value{100}) == bytes{0x18, 0x64});
+    REQUIRE(encode<W>(sk::value{1000}) == bytes{0x19, 0x03, 0xE8});
+    REQUIRE(encode<W>(sk::value{-1}) == bytes{0x20});
+    REQUIRE(encode<W>(sk::value{-1000}) == bytes{0x39, 0x03, 0xE7});
+    REQUIRE(encode<W>(sk::value{1.5}) ==
+            bytes{0xFB, 0x3F, 0xF8, 0, 0, 0, 0, 0, 0});
+    REQUIRE(encode<W>(sk::value{"IETF"}) == bytes{0x64, 'I', 'E', 'T', 'F'});
+}
+
+TEMPLATE_TEST_CASE("wire formats round-trip scalars", "", sk::msgpack_writer,
+                   sk::cbor_writer) {
+    using W = TestType;
+    using R = std::conditional_t<std::is_same_v<W, sk::msgpack_writer>,
+                                 sk::msgpack_reader, sk::cbor_reader>;
+
+    REQUIRE(round_trip<W, R>(sk::value{}).empty());
+    REQUIRE(round_trip<W, R>(sk::value{true}) == true);
+    REQUIRE(round_trip<W, R>(sk::value{false}) == false);
+    REQUIRE(round_trip<W, R>(sk::value{1.5f}) == 1.5f);
+    REQUIRE(round_trip<W, R>(sk::value{0.1}) == 0.1);
+    REQUIRE(round_trip<W, R>(sk::value{"hello"}) == "hello");
+    REQUIRE(round_trip<W, R>(sk::value{'c'}) == "c");
+
+    for (std::int64_t i :
+         {std::int64_t(0), std::int64_t(-1), std::int64_t(-32), std::int64_t(-33),
+          std::int64_t(127), std::int64_t(128), std::int64_t(-129),
+          std::int64_t(65536), std::int64_t(-70000), std::int64_t(1) << 40,
+          std::numeric_limits<std::int64_t>::min(),
+          std::numeric_limits<std::int64_t>::max()})
+        REQUIRE(round_trip<W, R>(sk::value{i}) == i);
+
+    auto big = std::numeric_limits<std::uint64_t>::max();
+    REQUIRE(round_trip<W, R>(sk::value{big}) == big);
+
+    std::string long_string(70000, 'x');
+    std::vector<std::byte> buf(long_string.size() + 16);
+    W w(buf);
+    w.write(sk::value{long_string});
+    R r(w.data());
+    sk::value v;
+    REQUIRE(r.read(v));
+    REQUIRE(v == long_string);
+    REQUIRE(!r.read(v));
+}
+
+TEMPLATE_TEST_CASE("wire formats round-trip arrays", "", sk::msgpack_writer,
+                   sk::cbor_writer) {
+    using W = TestType;
+    using R = std::conditional_t<std::is_same_v<W, sk::msgpack_writer>,
+                                 sk::msgpack_reader, sk::cbor_reader>;
+
+    std::vector<sk::value> row;
+    for (int i = 0; i < 20; ++i)
+        row.emplace_back(std::int64_t(i));
+    row.emplace_back();
+    row.emplace_back("x");
+
+    std::byte buf[256];
+    W w(buf);
+    w.write_array(row);
+    w.write_array(std::span<sk::value const>());
+
+    R r(w.data());
+    std::vector<sk::value> out;
+    REQUIRE(r.read_array(out));
+    REQUIRE(out == row);
+    REQUIRE(r.read_array(out));
+    REQUIRE(out.empty());
+    REQUIRE(!r.read_array(out));
+}
+
+TEMPLATE_TEST_CASE("wire readers can borrow strings", "", sk::msgpack_writer,
+                   sk::cbor_writer) {
+    using W = TestType;
+    using R = std::conditional_t<std::is_same_v<W, sk::msgpack_writer>,
+                                 sk::msgpack_reader, sk::cbor_reader>;
+
+    std::byte buf[64];
+    W w(buf);
+    w.write(sk::value{"borrowed"});
+
+    R r(w.data(), sk::value_wire_strings::borrow);
+    sk::value v;
+    REQUIRE(r.read(v));
+    auto s = sk::value_string_view(v);
+    REQUIRE(s);
+    REQUIRE(*s == "borrowed");
+    REQUIRE(static_cast<void const *>(s->data()) >=
+            static_cast<void const *>(buf));
+    REQUIRE(static_cast<void const *>(s->data()) <
+            static_cast<void const *>(buf + sizeof(buf)));
+}
+
+TEMPLATE_TEST_CASE("wire writers report a full buffer", "", sk::msgpack_writer,
+                   sk::cbor_writer) {
+    std::byte buf[4];
+    TestType w(buf);
+    REQUIRE_THROWS_AS(w.write(sk::value{"too long"}), sk::value_format_error);
+}
+
+TEST_CASE("wire readers reject malformed input") {
+    auto check_msgpack = [](bytes b) {
+        sk::msgpack_reader r(std::as_bytes(std::span(b)));
+        sk::value v;
+        REQUIRE_THROWS_AS(r.read(v), sk::value_format_error);
+    };
+    check_msgpack({0xA5, 'a'});       // truncated string
+    check_msgpack({0xCD, 0x01});      // truncated integer
+    check_msgpack({0x81, 0x01, 0x02}); // map
+    check_msgpack({0xC1});            // never used
+
+    auto check_cbor = [](bytes b) {
+        sk::cbor_reader r(std::as_bytes(std::span(b)));
+        sk::value v;
+        REQUIRE_THROWS_AS(r.read(v), sk::value_format_error);
+    };
+    check_cbor({0x64, 'a'});  // truncated string
+    check_cbor({0x7F, 0xFF}); // indefinite-length string
+    check_cbor({0xA0});       // map
+    check_cbor({0x1C});       // reserved length
+}
+
+TEST_CASE("cbor_reader accepts tags, half floats and indefinite arrays") {
+    bytes b{0xC1, 0x1A, 0x51, 0x4B, 0x67, 0xB0, // tag 1: epoch time
+            0xF9, 0x3C, 0x00,                    // half 1.0
+            0x9F, 0x01, 0x02, 0xFF};             // [_ 1, 2]
+    sk::cbor_reader r(std::as_bytes(std::span(b)));
+
+    sk::value v;
+    REQUIRE(r.read(v));
+    REQUIRE(v == std::int64_t(1363896240));
+    REQUIRE(r.read(v));
+    REQUIRE(v == 1.0f);
+
+    std::vector<sk::value> row;
+    REQUIRE(r.read_array(row));
+    REQUIRE(row.size() == 2);
+    REQUIRE(row[1] == std::int64_t(2));
+    REQUIRE(r.at_end());
+}